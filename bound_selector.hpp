@@ -0,0 +1,110 @@
+#ifndef BOUND_SELECTOR_HPP
+#define BOUND_SELECTOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+
+// Online per-depth choice between the available lower bounds.
+//
+// Every SAMPLE_PERIOD-th evaluation on a thread is a "sample": the caller
+// evaluates every bound on the same node, times each one and reports whether
+// it would have pruned. The selector keeps, per depth, the total cost and the
+// number of prunes of each bound and picks the one with the best
+// nodes-eliminated-per-nanosecond. All other evaluations just use the current
+// choice for that depth.
+class BoundSelector {
+public:
+    enum Kind {
+        BOUND_SIMPLE = 0,   // path distance + return edge to FIRST_NODE
+        BOUND_MIN_EDGE,     // path distance + half the cheapest-edge pairs (O(1))
+        BOUND_ONE_TREE,     // path distance + MST(remaining) + edges to both ends
+        NUM_BOUNDS
+    };
+
+    static const int MAX_DEPTH = 64;
+    static const int SAMPLE_PERIOD = 64;
+    static const int MIN_SAMPLES = 16;   // samples per depth before switching
+
+private:
+    struct DepthStats {
+        std::atomic<long long> samples;
+        std::atomic<long long> ns[NUM_BOUNDS];
+        std::atomic<long long> prunes[NUM_BOUNDS];
+        std::atomic<int> choice;
+    };
+
+    DepthStats _depth[MAX_DEPTH];
+    Kind _initial;
+
+    static int clampDepth(int depth) {
+        if (depth < 0) return 0;
+        if (depth >= MAX_DEPTH) return MAX_DEPTH - 1;
+        return depth;
+    }
+
+public:
+    typedef std::chrono::steady_clock clock;
+
+    explicit BoundSelector(Kind initial = BOUND_ONE_TREE) : _initial(initial) {
+        reset();
+    }
+
+    void reset() {
+        for (int d = 0; d < MAX_DEPTH; ++d) {
+            _depth[d].samples.store(0, std::memory_order_relaxed);
+            for (int k = 0; k < NUM_BOUNDS; ++k) {
+                _depth[d].ns[k].store(0, std::memory_order_relaxed);
+                _depth[d].prunes[k].store(0, std::memory_order_relaxed);
+            }
+            _depth[d].choice.store(_initial, std::memory_order_relaxed);
+        }
+    }
+
+    // true when the calling thread should evaluate and time every bound
+    bool sampleNow() {
+        static thread_local unsigned counter = 0;
+        return (counter++ % SAMPLE_PERIOD) == 0;
+    }
+
+    Kind choice(int depth) const {
+        return static_cast<Kind>(
+            _depth[clampDepth(depth)].choice.load(std::memory_order_relaxed));
+    }
+
+    void record(int depth, Kind k, long long ns, bool pruned) {
+        DepthStats& s = _depth[clampDepth(depth)];
+        s.ns[k].fetch_add(ns, std::memory_order_relaxed);
+        if (pruned) s.prunes[k].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // close a sample at this depth and re-evaluate the choice
+    void decide(int depth) {
+        DepthStats& s = _depth[clampDepth(depth)];
+        long long n = s.samples.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (n < MIN_SAMPLES) return;
+
+        // nodes eliminated per nanosecond; ties (e.g. nobody prunes here)
+        // go to the cheapest bound
+        int best = BOUND_SIMPLE;
+        double best_score = -1.0;
+        long long best_ns = LLONG_MAX;
+        for (int k = 0; k < NUM_BOUNDS; ++k) {
+            long long ns = s.ns[k].load(std::memory_order_relaxed);
+            long long pr = s.prunes[k].load(std::memory_order_relaxed);
+            double score = pr / (double)(ns + 1);
+            if (score > best_score || (score == best_score && ns < best_ns)) {
+                best = k;
+                best_score = score;
+                best_ns = ns;
+            }
+        }
+        s.choice.store(best, std::memory_order_relaxed);
+    }
+
+    static long long elapsedNs(clock::time_point t0, clock::time_point t1) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+};
+
+#endif // BOUND_SELECTOR_HPP
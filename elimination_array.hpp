@@ -0,0 +1,110 @@
+#ifndef ELIMINATION_ARRAY_HPP
+#define ELIMINATION_ARRAY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "task.hpp"
+
+// Elimination-backoff layer for a shared stack (Hendler, Shavit & Yerushalmi
+// 2004). A push that just lost a CAS on the stack head offers its task in a
+// random slot and waits briefly; a pop that lost a CAS looks at a random slot
+// and takes any task offered there. A push and a pop that meet cancel out
+// without touching the head, so contention turns into completed operations
+// instead of retries.
+//
+// Only pushers wait, poppers just look, so a slot only ever holds nothing,
+// one offered task, or the TAKEN mark that tells its pusher it was consumed.
+// The range of slots in use adapts: it doubles when a pusher finds its slot
+// busy (more contenders than slots) and halves when an offer times out (too
+// few partners to meet in that many slots).
+class EliminationArray {
+public:
+    static const int CAPACITY = 64;
+
+private:
+    static const int SPINS = 128;   // polls of the slot before withdrawing
+
+    struct alignas(64) Slot {
+        std::atomic<Task*> offer;
+    };
+
+    Slot _slot[CAPACITY];
+    std::atomic<int> _range;
+    std::atomic<long long> _eliminated;
+
+    static Task* taken() {
+        static char mark;
+        return reinterpret_cast<Task*>(&mark);
+    }
+
+    Slot& randomSlot() {
+        static thread_local uint32_t rng = 0;
+        if (!rng) rng = (uint32_t)reinterpret_cast<uintptr_t>(&rng) | 1u;
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return _slot[rng % (uint32_t)_range.load(std::memory_order_relaxed)];
+    }
+
+    void grow() {
+        int r = _range.load(std::memory_order_relaxed);
+        if (r < CAPACITY)
+            _range.compare_exchange_weak(r, r * 2 < CAPACITY ? r * 2 : CAPACITY,
+                                         std::memory_order_relaxed);
+    }
+
+    void shrink() {
+        int r = _range.load(std::memory_order_relaxed);
+        if (r > 1)
+            _range.compare_exchange_weak(r, r / 2, std::memory_order_relaxed);
+    }
+
+public:
+    EliminationArray() : _range(1), _eliminated(0) {
+        for (int i = 0; i < CAPACITY; ++i)
+            _slot[i].offer.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // push side: true when a pop took t, false when the caller must retry
+    // on the stack
+    bool offer(Task* t) {
+        Slot& s = randomSlot();
+        Task* expected = nullptr;
+        if (!s.offer.compare_exchange_strong(expected, t,
+                std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            grow();
+            return false;
+        }
+        for (int i = 0; i < SPINS; ++i) {
+            if (s.offer.load(std::memory_order_acquire) == taken()) {
+                s.offer.store(nullptr, std::memory_order_release);
+                _eliminated.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        expected = t;
+        if (s.offer.compare_exchange_strong(expected, nullptr,
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            shrink();
+            return false;
+        }
+        // taken between the last poll and the withdrawal
+        s.offer.store(nullptr, std::memory_order_release);
+        _eliminated.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // pop side: a task some push is offering right now, or nullptr
+    Task* visit() {
+        Slot& s = randomSlot();
+        Task* t = s.offer.load(std::memory_order_acquire);
+        if (t == nullptr || t == taken()) return nullptr;
+        if (s.offer.compare_exchange_strong(t, taken(),
+                std::memory_order_acq_rel, std::memory_order_relaxed))
+            return t;
+        return nullptr;
+    }
+
+    long long eliminated() const { return _eliminated.load(std::memory_order_relaxed); }
+    void resetStats() { _eliminated.store(0, std::memory_order_relaxed); }
+};
+
+#endif // ELIMINATION_ARRAY_HPP
@@ -0,0 +1,156 @@
+#ifndef HAZARD_POINTERS_HPP
+#define HAZARD_POINTERS_HPP
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+
+// Hazard pointers (Michael 2004) with one slot per thread, shared by every
+// lock-free structure in the process. A reader publishes the node it is
+// about to dereference with local().protect(), re-validates that the node
+// is still reachable, and calls clear() when done. A node unlinked from a structure
+// is handed to retire(); it is reclaimed by a later scan once no slot
+// points to it. Threads claim a slot on first use and give it back when
+// they exit; their remaining retired nodes are adopted by the next scan.
+class HazardPointers {
+public:
+    static const int MAX_THREADS = 512;
+    typedef void (*Reclaimer)(void*);
+
+private:
+    // a thread scans once it holds 2 * (slots in use) + SCAN_SLACK retired
+    // nodes: the sweep stays O(1) per node, and with few threads nodes go
+    // back to the allocator while they are still hot in cache
+    static const size_t SCAN_SLACK = 32;
+
+    struct alignas(64) Slot {
+        std::atomic<void*> ptr;
+        std::atomic<bool> used;
+    };
+
+    struct Retired {
+        void* ptr;
+        Reclaimer reclaim;
+    };
+
+public:
+    // the calling thread's slot and retired list; look it up once per
+    // operation, each lookup goes through the thread_local guard
+    class Local {
+    private:
+        friend class HazardPointers;
+        Slot* slot;
+        std::vector<Retired> retired;
+        std::vector<void*> hazards;   // scan() scratch, kept to avoid reallocating
+        Local() : slot(instance().acquireSlot()) {}
+    public:
+        ~Local() { instance().releaseSlot(*this); }
+
+        // publish p as in use by this thread; the caller must re-check that
+        // p is still reachable before dereferencing it. The fence keeps that
+        // re-check (typically an acquire load) from being ordered before the
+        // store; it pairs with the fence in scan(), so either the scan sees
+        // the hazard or the re-check sees p unlinked.
+        void protect(void* p) {
+            slot->ptr.store(p, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        void clear() { slot->ptr.store(nullptr, std::memory_order_release); }
+
+        // p is unreachable for new readers; reclaim(p) runs once no slot holds it
+        void retire(void* p, Reclaimer reclaim) {
+            retired.push_back(Retired{p, reclaim});
+            HazardPointers& d = instance();
+            if (retired.size() >= 2 * (size_t)d._high_water.load(std::memory_order_relaxed) + SCAN_SLACK)
+                d.scan(retired, hazards);
+        }
+    };
+
+    static Local& local() {
+        static thread_local Local l;
+        return l;
+    }
+
+    static HazardPointers& instance() {
+        static HazardPointers domain;
+        return domain;
+    }
+
+private:
+    Slot _slots[MAX_THREADS];
+    std::mutex _orphan_mutex;
+    std::vector<Retired> _orphans;
+    std::atomic<bool> _has_orphans;
+    std::atomic<int> _high_water;   // slots [0, _high_water) have been used
+
+    HazardPointers() : _has_orphans(false), _high_water(0) {
+        for (int i = 0; i < MAX_THREADS; ++i) {
+            _slots[i].ptr.store(nullptr, std::memory_order_relaxed);
+            _slots[i].used.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    ~HazardPointers() {
+        for (const Retired& r : _orphans) r.reclaim(r.ptr);
+    }
+
+    Slot* acquireSlot() {
+        for (int i = 0; i < MAX_THREADS; ++i) {
+            bool expected = false;
+            if (!_slots[i].used.load(std::memory_order_relaxed)
+                && _slots[i].used.compare_exchange_strong(expected, true,
+                       std::memory_order_acquire, std::memory_order_relaxed)) {
+                int hw = _high_water.load(std::memory_order_relaxed);
+                while (hw <= i && !_high_water.compare_exchange_weak(hw, i + 1,
+                           std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                }
+                return &_slots[i];
+            }
+        }
+        throw std::runtime_error("HazardPointers: more than MAX_THREADS threads");
+    }
+
+    void releaseSlot(Local& l) {
+        l.slot->ptr.store(nullptr, std::memory_order_release);
+        scan(l.retired, l.hazards);
+        if (!l.retired.empty()) {
+            std::lock_guard<std::mutex> lock(_orphan_mutex);
+            _orphans.insert(_orphans.end(), l.retired.begin(), l.retired.end());
+            _has_orphans.store(true, std::memory_order_relaxed);
+        }
+        l.slot->used.store(false, std::memory_order_release);
+    }
+
+    // reclaim every node of list that no slot protects
+    void scan(std::vector<Retired>& list, std::vector<void*>& hazards) {
+        if (_has_orphans.load(std::memory_order_relaxed) && _orphan_mutex.try_lock()) {
+            list.insert(list.end(), _orphans.begin(), _orphans.end());
+            _orphans.clear();
+            _has_orphans.store(false, std::memory_order_relaxed);
+            _orphan_mutex.unlock();
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int n = _high_water.load(std::memory_order_acquire);
+        hazards.clear();
+        for (int i = 0; i < n; ++i) {
+            void* p = _slots[i].ptr.load(std::memory_order_acquire);
+            if (p) hazards.push_back(p);
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        size_t kept = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (std::binary_search(hazards.begin(), hazards.end(), list[i].ptr))
+                list[kept++] = list[i];
+            else
+                list[i].reclaim(list[i].ptr);
+        }
+        list.resize(kept);
+    }
+
+};
+
+#endif // HAZARD_POINTERS_HPP
@@ -0,0 +1,88 @@
+#ifndef HEURISTIC_PORTFOLIO_HPP
+#define HEURISTIC_PORTFOLIO_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include "modified_tsptask.hpp"
+#include "tsp_heuristics.hpp"
+
+// Improvement heuristics running next to the branch-and-bound workers.
+// Each thread does iterated local search: a randomized nearest-neighbour
+// restart improved by 2-opt / Or-opt, then double-bridge kicks, keeping a
+// kicked tour when local search makes it shorter. Every tour that beats the
+// global incumbent is published with ModifiedTSPTask::updateBestPath(), so
+// the exact search prunes against it right away.
+class HeuristicPortfolio {
+private:
+    static const int KICKS_PER_RESTART = 200;
+
+    std::vector<std::thread> _threads;
+    std::atomic<bool> _stop;
+    std::atomic<int> _improvements;
+
+    void worker_function(unsigned seed) {
+        std::mt19937 rng(seed);
+        const int W = TSPPath::MAX_GRAPH;
+        const int* dist = TSPPath::distanceRow(0);
+        const int n = TSPPath::full();
+        std::uniform_int_distribution<int> pick_start(0, n - 1);
+
+        while (!_stop.load(std::memory_order_relaxed)) {
+            // randomized restart
+            std::vector<int> tour = nearestNeighbourTour(n, dist, W, pick_start(rng));
+            rotateToFront(tour, TSPPath::FIRST_NODE);
+            localSearch(tour, dist, W);
+            int len = tourLength(tour, dist, W);
+            publish(tour, len);
+
+            for (int k = 0; k < KICKS_PER_RESTART; ++k) {
+                if (_stop.load(std::memory_order_relaxed)) return;
+                std::vector<int> kicked(tour);
+                doubleBridge(kicked, rng);
+                localSearch(kicked, dist, W);
+                int kicked_len = tourLength(kicked, dist, W);
+                if (kicked_len < len) {
+                    tour.swap(kicked);
+                    len = kicked_len;
+                    publish(tour, len);
+                }
+            }
+        }
+    }
+
+    void publish(const std::vector<int>& tour, int len) {
+        if (len >= ModifiedTSPTask::bestDistance()) return;
+        if (ModifiedTSPTask::updateBestPath(ModifiedTSPTask::tourToPath(tour)))
+            _improvements.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    HeuristicPortfolio() : _stop(false), _improvements(0) {}
+
+    ~HeuristicPortfolio() {
+        stop();
+    }
+
+    // TSPPath::setup() and the root ModifiedTSPTask must exist already
+    void start(int num_threads) {
+        _stop.store(false, std::memory_order_relaxed);
+        _improvements.store(0, std::memory_order_relaxed);
+        std::random_device rd;
+        for (int i = 0; i < num_threads; ++i)
+            _threads.emplace_back(&HeuristicPortfolio::worker_function, this, rd() + i);
+    }
+
+    void stop() {
+        _stop.store(true, std::memory_order_relaxed);
+        for (auto& t : _threads) {
+            if (t.joinable()) t.join();
+        }
+        _threads.clear();
+    }
+
+    int getImprovements() const { return _improvements.load(); }
+};
+
+#endif // HEURISTIC_PORTFOLIO_HPP
@@ -0,0 +1,93 @@
+#ifndef IDLE_PARKING_HPP
+#define IDLE_PARKING_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// Where idle workers sleep until work shows up (an event count).
+//
+// A worker that has spun long enough calls prepare(), checks once more for
+// work and for termination, and then either cancel()s or park()s with the
+// ticket prepare() gave it. A producer calls wake(n) after publishing n
+// tasks. prepare() announces the sleeper before the final check, and wake()
+// publishes its tasks before looking for sleepers, both seq_cst, so either
+// the sleeper's check sees the tasks or the producer sees the sleeper and
+// bumps the epoch, which makes a park() on the old ticket return at once.
+//
+// Sleeping is a futex wait on the epoch word on Linux, a condition variable
+// elsewhere.
+class IdleParking {
+private:
+    std::atomic<int> _sleepers;
+    std::atomic<uint32_t> _epoch;
+    std::atomic<long long> _parks;
+#ifndef __linux__
+    std::mutex _mutex;
+    std::condition_variable _cv;
+#endif
+
+    void signal(int n) {
+        _epoch.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_epoch), FUTEX_WAKE_PRIVATE, n,
+                nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (n == 1) _cv.notify_one(); else _cv.notify_all();
+#endif
+    }
+
+public:
+    IdleParking() : _sleepers(0), _epoch(0), _parks(0) {}
+
+    uint32_t prepare() {
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return _epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancel() {
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // sleep unless someone woke sleepers since prepare() returned ticket;
+    // may return spuriously, callers loop back and look for work
+    void park(uint32_t ticket) {
+        _parks.fetch_add(1, std::memory_order_relaxed);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_epoch), FUTEX_WAIT_PRIVATE, ticket,
+                nullptr, nullptr, 0);
+#else
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [&] { return _epoch.load(std::memory_order_seq_cst) != ticket; });
+#endif
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // after publishing n tasks: wake up to n sleepers, none if nobody sleeps
+    void wake(int n) {
+        if (n <= 0) return;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleepers.load(std::memory_order_seq_cst) > 0) signal(n);
+    }
+
+    // termination or cancellation: everybody up
+    void wakeAll() {
+        signal(INT_MAX);
+    }
+
+    long long parks() const { return _parks.load(std::memory_order_relaxed); }
+    void resetStats() { _parks.store(0, std::memory_order_relaxed); }
+};
+
+#endif // IDLE_PARKING_HPP
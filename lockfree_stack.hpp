@@ -5,19 +5,183 @@
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <mutex>
+#include <vector>
 #include "task.hpp"
+#include "hazard_pointers.hpp"
+#include "elimination_array.hpp"
 
+// The head packs a 16-bit tag into the unused top bits of the pointer and is
+// updated with a plain 64-bit CAS. Nodes are only recycled through hazard
+// pointers, so a node that a pop() has protected cannot leave the stack and
+// come back as the head: comparing pointers is already enough, and a wrapped
+// tag cannot cause ABA. Build with -DLOCKFREE_STACK_DWCAS (and -mcx16) for a
+// 128-bit head with a full 64-bit counter updated by cmpxchg16b instead; it
+// is not the default because the double-width CAS makes single-threaded
+// push/pop about 30% slower.
+#if defined(LOCKFREE_STACK_DWCAS) && !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#error "LOCKFREE_STACK_DWCAS needs a double-width CAS (cmpxchg16b, -mcx16)"
+#endif
+
+// next is atomic because popMany() may follow links of nodes that other
+// threads are popping or recycling. Links are stored with release and
+// followed with acquire, so a node reached through a link is always fully
+// initialized; on x86 both are plain moves.
 struct LFNode {
     Task* task;
-    LFNode* next;
+    std::atomic<LFNode*> next;
     explicit LFNode(Task* t) : task(t), next(nullptr) {}
 };
 
+// Recycler for LFNodes, so steady-state push/pop never calls malloc. Each
+// thread keeps a free list linked through next; past LOCAL_MAX nodes it
+// spills a BATCH-long chain to a global list, and an empty thread refills
+// from there before falling back to new. The global lock is taken once per
+// BATCH nodes moved. Nodes are never freed: the pool only grows to the peak
+// number of nodes in flight.
+class LFNodePool {
+private:
+    static const int BATCH = 64;
+    static const int LOCAL_MAX = 2 * BATCH;
+
+    // trivially destructible, so it stays usable while other thread_locals
+    // (e.g. the hazard pointer records that release nodes) are destroyed
+    struct Cache {
+        LFNode* head;
+        int count;
+        bool closed;   // thread exiting: release straight to the global list
+    };
+
+    struct Chain {
+        LFNode* head;
+        int count;
+    };
+
+    struct Global {
+        std::mutex lock;
+        std::vector<Chain> chains;
+    };
+
+    // hands the thread's cache back to the global list when the thread exits
+    struct Flusher {
+        ~Flusher() {
+            Cache& c = cache();
+            if (c.head) put(Chain{c.head, c.count});
+            c.head = nullptr;
+            c.count = 0;
+            c.closed = true;
+        }
+    };
+
+    static Cache& cache() {
+        static thread_local Cache c = { nullptr, 0, false };
+        return c;
+    }
+
+    static void registerFlusher() {
+        static thread_local Flusher f;
+        (void)f;
+    }
+
+    // never destroyed: nodes may still be released during static destruction
+    static Global& global() {
+        static Global* g = new Global();
+        return *g;
+    }
+
+    static void put(const Chain& chain) {
+        Global& g = global();
+        std::lock_guard<std::mutex> guard(g.lock);
+        g.chains.push_back(chain);
+    }
+
+    static void refill(Cache& c) {
+        Global& g = global();
+        std::lock_guard<std::mutex> guard(g.lock);
+        if (g.chains.empty()) return;
+        c.head = g.chains.back().head;
+        c.count = g.chains.back().count;
+        g.chains.pop_back();
+    }
+
+    static void spill(Cache& c) {
+        LFNode* first = c.head;
+        LFNode* last = first;
+        for (int i = 1; i < BATCH; ++i) last = last->next.load(std::memory_order_relaxed);
+        c.head = last->next.load(std::memory_order_relaxed);
+        c.count -= BATCH;
+        last->next.store(nullptr, std::memory_order_release);
+        put(Chain{first, BATCH});
+    }
+
+public:
+    static LFNode* allocate(Task* t) {
+        Cache& c = cache();
+        if (!c.head) {
+            registerFlusher();
+            refill(c);
+            if (!c.head) return new LFNode(t);
+        }
+        LFNode* node = c.head;
+        c.head = node->next.load(std::memory_order_relaxed);
+        --c.count;
+        node->task = t;
+        node->next.store(nullptr, std::memory_order_release);
+        return node;
+    }
+
+    static void release(LFNode* node) {
+        Cache& c = cache();
+        if (c.closed) {
+            node->next.store(nullptr, std::memory_order_release);
+            put(Chain{node, 1});
+            return;
+        }
+        if (!c.head) registerFlusher();
+        node->next.store(c.head, std::memory_order_release);
+        c.head = node;
+        if (++c.count > LOCAL_MAX) spill(c);
+    }
+};
+
 class LockFreeStack : public TaskCollection {
 private:
+    struct Head {
+        LFNode* ptr;
+        uint64_t count;
+    };
+
+#ifdef LOCKFREE_STACK_DWCAS
+    struct alignas(16) HeadWord {
+        LFNode* ptr;
+        uint64_t count;
+    };
+    HeadWord head{nullptr, 0};
+
+    // the two halves may be read from different versions of the head; the
+    // CAS compares all 128 bits, so a torn read only costs a retry
+    Head loadHead() const {
+        Head h;
+        h.count = __atomic_load_n(&head.count, __ATOMIC_ACQUIRE);
+        h.ptr = __atomic_load_n(&head.ptr, __ATOMIC_ACQUIRE);
+        return h;
+    }
+
+    bool casHead(const Head& expected, LFNode* ptr) {
+        HeadWord e = { expected.ptr, expected.count };
+        HeadWord d = { ptr, expected.count + 1 };
+        unsigned __int128 e128, d128;
+        std::memcpy(&e128, &e, sizeof e128);
+        std::memcpy(&d128, &d, sizeof d128);
+        return __sync_bool_compare_and_swap(reinterpret_cast<unsigned __int128*>(&head),
+                                            e128, d128);
+    }
+#else
     // Pack pointer+tag in one 64-bit word: [ tag:16 | ptr:48 ]
     std::atomic<uint64_t> headPacked{0};
-    std::atomic<int> size_counter{0};
 
     static uint64_t pack(LFNode* ptr, uint16_t tag) {
         uint64_t p = reinterpret_cast<uint64_t>(ptr);
@@ -26,16 +190,42 @@ private:
         return (static_cast<uint64_t>(tag) << 48) | p;
     }
 
-    static LFNode* unpackPtr(uint64_t packed) {
-        uint64_t p = packed & 0x0000FFFFFFFFFFFFULL;
-        return reinterpret_cast<LFNode*>(p);
+    Head loadHead() const {
+        uint64_t packed = headPacked.load(std::memory_order_acquire);
+        Head h;
+        h.ptr = reinterpret_cast<LFNode*>(packed & 0x0000FFFFFFFFFFFFULL);
+        h.count = packed >> 48;
+        return h;
     }
 
-    static uint16_t unpackTag(uint64_t packed) {
-        return static_cast<uint16_t>(packed >> 48);
+    bool casHead(const Head& expected, LFNode* ptr) {
+        uint64_t oldPacked = pack(expected.ptr, static_cast<uint16_t>(expected.count));
+        // strong: a spurious failure would send the caller to the elimination array
+        return headPacked.compare_exchange_strong(oldPacked,
+                pack(ptr, static_cast<uint16_t>(expected.count + 1)),
+                std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+#endif
+
+    std::atomic<int> size_counter{0};
+
+    // where a push and a pop that lost a CAS on the head can meet
+    EliminationArray elimination;
+
+    static void reclaimNode(void* p) {
+        LFNodePool::release(static_cast<LFNode*>(p));
     }
 
 public:
+    // the elimination slots are cache-line aligned, which C++11 new does not
+    // honour; ParallelTaskRunner allocates one stack per NUMA node
+    static void* operator new(size_t size) {
+        void* p = nullptr;
+        if (posix_memalign(&p, alignof(LockFreeStack), size) != 0) throw std::bad_alloc();
+        return p;
+    }
+    static void operator delete(void* p) { std::free(p); }
+
     LockFreeStack() = default;
 
     ~LockFreeStack() override {
@@ -50,61 +240,140 @@ public:
 
     void push(Task* task) override {
         if (!task) return;
-        LFNode* node = new LFNode(task);
+        LFNode* node = LFNodePool::allocate(task);
 
         while (true) {
-            uint64_t oldPacked = headPacked.load(std::memory_order_acquire);
-            LFNode* oldHead = unpackPtr(oldPacked);
-            uint16_t oldTag = unpackTag(oldPacked);
+            Head h = loadHead();
+            node->next.store(h.ptr, std::memory_order_release);
+            if (casHead(h, node)) {
+                size_counter.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            // contended: try to hand the task straight to a concurrent pop();
+            // the node was never published, so it goes back to the pool now
+            if (elimination.offer(task)) {
+                LFNodePool::release(node);
+                return;
+            }
+        }
+    }
 
-            node->next = oldHead;
-            uint64_t newPacked = pack(node, static_cast<uint16_t>(oldTag + 1));
+    // link the batch privately, then publish it with a single CAS
+    void pushMany(Task** tasks, int n) override {
+        if (n <= 0) return;
+        LFNode* bottom = LFNodePool::allocate(tasks[0]);
+        LFNode* top = bottom;
+        for (int i = 1; i < n; ++i) {
+            LFNode* node = LFNodePool::allocate(tasks[i]);
+            node->next.store(top, std::memory_order_release);
+            top = node;
+        }
 
-            if (headPacked.compare_exchange_weak(oldPacked, newPacked,
-                    std::memory_order_release, std::memory_order_acquire)) {
-                size_counter.fetch_add(1, std::memory_order_relaxed);
+        while (true) {
+            Head h = loadHead();
+            bottom->next.store(h.ptr, std::memory_order_release);
+            if (casHead(h, top)) {
+                size_counter.fetch_add(n, std::memory_order_relaxed);
                 return;
             }
+            // contended: the top task is the one a pop would get first
+            if (elimination.offer(top->task)) {
+                LFNode* rest = top->next.load(std::memory_order_relaxed);
+                LFNodePool::release(top);
+                if (--n == 0) return;
+                top = rest;
+            }
         }
     }
 
     Task* pop() override {
+        HazardPointers::Local& hp = HazardPointers::local();
         while (true) {
-            uint64_t oldPacked = headPacked.load(std::memory_order_acquire);
-            LFNode* oldHead = unpackPtr(oldPacked);
-            uint16_t oldTag = unpackTag(oldPacked);
-
-            if (!oldHead) return nullptr;
+            Head h = loadHead();
+            if (!h.ptr) {
+                hp.clear();
+                return nullptr;
+            }
 
-            LFNode* next = oldHead->next;
-            uint64_t newPacked = pack(next, static_cast<uint16_t>(oldTag + 1));
+            // h.ptr cannot be reclaimed once protected, as long as it was
+            // still the head after the hazard became visible
+            hp.protect(h.ptr);
+            if (loadHead().ptr != h.ptr) continue;
 
-            if (headPacked.compare_exchange_weak(oldPacked, newPacked,
-                    std::memory_order_release, std::memory_order_acquire)) {
-                Task* t = oldHead->task;
-                delete oldHead; // free node structure; task ownership returns to caller
+            LFNode* next = h.ptr->next.load(std::memory_order_acquire);
+            if (casHead(h, next)) {
+                hp.clear();
+                Task* t = h.ptr->task;
+                // recycle node structure once no reader holds it; task ownership returns to caller
+                hp.retire(h.ptr, reclaimNode);
                 size_counter.fetch_sub(1, std::memory_order_relaxed);
                 return t;
             }
+            if (Task* t = elimination.visit()) {
+                hp.clear();
+                return t;
+            }
+        }
+    }
+
+    // Detach up to max nodes with a single CAS. Only the head is protected;
+    // the links below it are read unprotected, which is safe because pooled
+    // nodes are never freed, and nothing below the head can change unless
+    // the head itself is popped, after which it cannot be the head again
+    // while we protect it, so the CAS fails.
+    int popMany(Task** out, int max) override {
+        if (max <= 0) return 0;
+        HazardPointers::Local& hp = HazardPointers::local();
+        while (true) {
+            Head h = loadHead();
+            if (!h.ptr) {
+                hp.clear();
+                return 0;
+            }
+            hp.protect(h.ptr);
+            if (loadHead().ptr != h.ptr) continue;
+
+            LFNode* last = h.ptr;
+            int n = 1;
+            while (n < max) {
+                LFNode* next = last->next.load(std::memory_order_acquire);
+                if (!next) break;
+                last = next;
+                ++n;
+            }
+            LFNode* rest = last->next.load(std::memory_order_acquire);
+            if (casHead(h, rest)) {
+                hp.clear();
+                LFNode* cur = h.ptr;
+                for (int i = 0; i < n; ++i) {
+                    LFNode* next = cur->next.load(std::memory_order_relaxed);
+                    out[i] = cur->task;
+                    hp.retire(cur, reclaimNode);
+                    cur = next;
+                }
+                size_counter.fetch_sub(n, std::memory_order_relaxed);
+                return n;
+            }
+            if (Task* t = elimination.visit()) {
+                hp.clear();
+                out[0] = t;
+                return 1;
+            }
         }
     }
 
     void clear() override {
         while (true) {
-            uint64_t oldPacked = headPacked.load(std::memory_order_acquire);
-            LFNode* oldHead = unpackPtr(oldPacked);
-            if (!oldHead) break;
-            // try to set head to null with tag+1
-            uint16_t oldTag = unpackTag(oldPacked);
-            uint64_t newPacked = pack(nullptr, static_cast<uint16_t>(oldTag + 1));
-            if (headPacked.compare_exchange_weak(oldPacked, newPacked,
-                    std::memory_order_release, std::memory_order_acquire)) {
+            Head h = loadHead();
+            if (!h.ptr) break;
+            if (casHead(h, nullptr)) {
                 // drain list
-                LFNode* cur = oldHead;
+                HazardPointers::Local& hp = HazardPointers::local();
+                LFNode* cur = h.ptr;
                 while (cur) {
-                    LFNode* nxt = cur->next;
+                    LFNode* nxt = cur->next.load(std::memory_order_relaxed);
                     delete cur->task;
-                    delete cur;
+                    hp.retire(cur, reclaimNode);
                     cur = nxt;
                 }
                 size_counter.store(0, std::memory_order_relaxed);
@@ -113,8 +382,12 @@ public:
         }
     }
 
+    // push/pop pairs that met in the elimination array
+    long long eliminated() const { return elimination.eliminated(); }
+    void resetStats() { elimination.resetStats(); }
+
     bool empty() const {
-        return unpackPtr(headPacked.load(std::memory_order_acquire)) == nullptr;
+        return loadHead().ptr == nullptr;
     }
 };
 
@@ -5,13 +5,20 @@
 #include <climits>
 #include <atomic>
 #include <vector>
-#include <mutex>
 #include <stdexcept>
 #include <ostream>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <functional>
 
 #include "tspgraph.hpp"
 #include "task.hpp"
 #include "lockfree_stack.hpp"
+#include "bound_selector.hpp"
+#include "simd_kernels.hpp"
+#include "tsp_heuristics.hpp"
+#include "numa_replica.hpp"
 
 class TSPPath;
 
@@ -23,23 +30,81 @@ public:
     static const int MAX_GRAPH = 32;
 private:
     static TSPGraph* _graph;
-    int _node[MAX_GRAPH];
+
+    // everything the bounds and the DFS read about the graph
+    struct Tables {
+        // flat, aligned, zero-padded copy of the distance matrix for the
+        // kernels; back[j] is the distance from j back to FIRST_NODE
+        alignas(64) int dist[MAX_GRAPH][MAX_GRAPH];
+        alignas(64) int back[MAX_GRAPH];
+        // two cheapest edges incident to each node, and their sum over all nodes
+        alignas(64) int min1[MAX_GRAPH];
+        alignas(64) int min2[MAX_GRAPH];
+        int min_sum_all;
+    };
+    // setup() fills _master; each thread reads through _tables, which is
+    // _master unless useNodeReplica() pointed it at its node's copy
+    static Tables _master;
+    static thread_local const Tables* _tables;
+    static NodeReplicas<Tables> _replicas;
+    static unsigned _generation;   // bumped by setup(), makes replicas stale
+
+    int _node[MAX_GRAPH + 1];   // + closing return to FIRST_NODE
     int _size;
     int _distance;
+    int _open_min_sum;  // sum of _min1 + _min2 over nodes not in the path
     std::bitset<MAX_GRAPH> _contents;
+
+    static int minPair(int node) { return _tables->min1[node] + _tables->min2[node]; }
+
 public:
     static void setup(TSPGraph *graph) {
         _graph = graph;
         if (_graph->size() > MAX_GRAPH)
             throw std::runtime_error("Graph bigger than MAX_GRAPH");
+        int n = _graph->size();
+        Tables& t = _master;
+        for (int v = 0; v < MAX_GRAPH; ++v) {
+            for (int u = 0; u < MAX_GRAPH; ++u)
+                t.dist[v][u] = (v < n && u < n) ? _graph->distance(v, u) : 0;
+            t.back[v] = t.dist[v][FIRST_NODE];
+            t.min1[v] = t.min2[v] = 0;
+        }
+        t.min_sum_all = 0;
+        for (int v = 0; v < n; ++v) {
+            int m1 = INT_MAX, m2 = INT_MAX;
+            for (int u = 0; u < n; ++u) {
+                if (u == v) continue;
+                int w = _graph->distance(v, u);
+                if (w < m1) { m2 = m1; m1 = w; }
+                else if (w < m2) { m2 = w; }
+            }
+            if (m1 == INT_MAX) m1 = 0;
+            if (m2 == INT_MAX) m2 = m1;   // two-node graph: both tour edges are the same
+            t.min1[v] = m1;
+            t.min2[v] = m2;
+            t.min_sum_all += m1 + m2;
+        }
+        ++_generation;
     }
+
+    // Point the calling thread at node's copy of the tables, creating or
+    // refreshing it first; call on a thread pinned to that node, at the
+    // start of a run (see NodeReplicas).
+    static void useNodeReplica(int node) { _tables = _replicas.get(node, _master, _generation); }
+    static void setReplicaHugePages(bool on) { _replicas.setHugePages(on); }
+
     static int full() { return _graph->size(); }
-    static int graphDistance(int a, int b) { return _graph->distance(a, b); }
+    static int graphDistance(int a, int b) { return _tables->dist[a][b]; }
+    // aligned, MAX_GRAPH-wide rows for the vector kernels
+    static const int* distanceRow(int a) { return _tables->dist[a]; }
+    static const int* backColumn() { return _tables->back; }
 
     TSPPath() {
         _node[0] = FIRST_NODE;
         _size = 1;
         _distance = 0;
+        _open_min_sum = _tables->min_sum_all - minPair(FIRST_NODE);
         _contents.reset();
         _contents.set(FIRST_NODE);
     }
@@ -49,11 +114,20 @@ public:
     int distance() const { return _distance; }
     bool contains(int i) const { return _contents.test(i); }
     int tail() const { return _node[_size-1]; }
+    int node(int i) const { return _node[i]; }
+
+    // bitmask of the graph nodes not yet in the path
+    uint32_t openNodes() const {
+        int n = full();
+        uint32_t graph = n >= 32 ? 0xFFFFFFFFu : ((1u << n) - 1);
+        return graph & ~(uint32_t)_contents.to_ulong();
+    }
 
     void push(int node) {
         if (node >= _graph->size())
             throw std::runtime_error("Node outside graph.");
-        _distance += _graph->distance(tail(), node);
+        _distance += _tables->dist[tail()][node];
+        if (!_contents.test(node)) _open_min_sum -= minPair(node);
         _contents.set(node);
         _node[_size++] = node;
     }
@@ -64,9 +138,55 @@ public:
         _size--;
         int oldtail = _node[_size];
         int newtail = _node[_size-1];
-        if (oldtail != FIRST_NODE)
+        if (oldtail != FIRST_NODE) {
             _contents.reset(oldtail);
-        _distance -= _graph->distance(newtail, oldtail);
+            _open_min_sum += minPair(oldtail);
+        }
+        _distance -= _tables->dist[newtail][oldtail];
+    }
+
+    // O(1) admissible bound: every edge of the remaining route tail -> ... ->
+    // FIRST_NODE is counted from both ends, each unvisited node contributes
+    // at least its two cheapest edges and each end at least its cheapest one
+    int minEdgeBound() const {
+        if (_size > full()) return _distance;   // tour already closed
+        const Tables& t = *_tables;
+        return _distance + (_open_min_sum + t.min1[tail()] + t.min1[FIRST_NODE] + 1) / 2;
+    }
+
+    // Symmetric instances: each tour is kept in the direction where the last
+    // city is lower than the second one. Rejects node if pushing it makes that
+    // impossible, i.e. no unvisited city below the second one remains.
+    bool symmetryAllows(int node) const {
+        int n = full();
+        if (n < 3) return true;
+        int second = _size < 2 ? node : _node[1];
+        unsigned long open = ~_contents.to_ulong() & ((1UL << n) - 1);
+        open &= ~(1UL << node);
+        if (!open) return node < second;            // node is the last city
+        unsigned long below = (1UL << second) - 1;
+        return (open & below) != 0;
+    }
+
+    // cheap bound for the child obtained by pushing node, without pushing it
+    int boundWith(int node) const {
+        const Tables& t = *_tables;
+        int dist = _distance + t.dist[tail()][node];
+        int ret = dist + t.back[node];
+        int open = _open_min_sum - minPair(node);
+        int half = dist + (open + t.min1[node] + t.min1[FIRST_NODE] + 1) / 2;
+        return half > ret ? half : ret;
+    }
+
+    // boundWith() for every child at once (SIMD). key[] receives MAX_GRAPH
+    // bounds and must be 64-byte aligned; bit i of the result is set when
+    // node i is unvisited and its bound is below best.
+    uint32_t childSurvivors(int best, int* key) const {
+        const Tables& t = *_tables;
+        int c = _open_min_sum + t.min1[FIRST_NODE] + 1;
+        uint32_t alive = siblingBounds(t.dist[tail()], t.back, t.min2,
+                                       _distance, c, best, key, MAX_GRAPH);
+        return alive & openNodes();
     }
 
     void write(std::ostream& os) const {
@@ -82,6 +202,7 @@ public:
         if (this != &other) {
             _size = other._size;
             _distance = other._distance;
+            _open_min_sum = other._open_min_sum;
             _contents = other._contents;
             for (int i = 0; i < _size; ++i) _node[i] = other._node[i];
         }
@@ -94,190 +215,468 @@ inline std::ostream& operator<<(std::ostream& os, const TSPPath& t) {
     return os;
 }
 
+// The incumbent distance on a cache line of its own, so that the CAS of an
+// improvement does not also invalidate neighbouring hot statics.
+struct alignas(64) PaddedAtomicInt {
+    std::atomic<int> value;
+    PaddedAtomicInt(int v) : value(v) {}
+};
+
+// A published incumbent tour. Never modified after publication, so a reader
+// holding the pointer always sees a tour and distance that belong together.
+// Older snapshots stay reachable through prev and are reclaimed only between
+// runs, when no worker can still be reading them.
+struct IncumbentSnapshot {
+    TSPPath path;
+    IncumbentSnapshot* prev;
+    IncumbentSnapshot(const TSPPath& p) : path(p), prev(nullptr) {}
+};
+
 class ModifiedTSPTask : public Task {
+public:
+    // Called from whichever thread had its tour accepted by updateBestPath(),
+    // right after publication; seconds are counted from the root task's
+    // construction. Callbacks run concurrently and must be thread-safe.
+    typedef std::function<void(const TSPPath& tour, double seconds,
+                               std::thread::id thread)> ImprovementCallback;
+
 private:
+    // a task re-reads the shared incumbent once every this many uses
+    static const int BEST_REFRESH_PERIOD = 64;
+
+    // lazy splitting sheds a subtree only if this many cities are still
+    // open below its root; smaller ones cost more to hand over than to solve
+    static const int MIN_SHED_OPEN = 5;
+
     // shared among all tasks
-    static std::atomic<int> best_distance;
-    static TSPPath best_path;
-    static std::mutex best_path_mutex;
+    static PaddedAtomicInt best_distance;
+    static std::atomic<IncumbentSnapshot*> best_snapshot;
+
+    // anytime mode: raised by the runner when its time budget is spent;
+    // open_bound collects the bounds of subtrees left unexplored
+    static CancellationToken* _cancel;
+    static std::atomic<int> open_bound;
 
     static std::atomic<bool> initial_bound_set;
     static int _cutoff_size;
 
+    // full bound applied in solve() and to split() children until this many
+    // cities remain; the last levels use the inline check only
+    static int _strong_bound_cutoff;
+
+    // explore each tour of a symmetric instance in one direction only
+    static bool _break_symmetry;
+
+    // per-depth choice of lower bound, fed by sampled prune rates
+    static BoundSelector bound_selector;
+    static bool _adaptive_bounds;
+
+    // epsilon-optimal mode: prune when lower_bound * (1 + eps) >= incumbent
+    static double _epsilon;
+
+    // optional starting tour (e.g. yesterday's answer), FIRST_NODE first
+    static std::vector<int> _seed_tour;
+
+    // split() leaves everything to solve(), which sheds work on demand
+    static bool _lazy_split;
+
+    static ImprovementCallback _on_improvement;
+    static std::chrono::steady_clock::time_point _search_start;
+
+    // One level of the DFS in solve(): the sorted children of the path
+    // prefix of length depth, next is the first one not tried yet.
+    struct Frame {
+        const int* child;
+        const int* key;
+        int next;
+        int count;
+        int depth;
+        Frame* parent;
+    };
+
     TSPPath _path;
+    // task-local copy of the pruning limit (see pruneLimit()); a stale value
+    // only prunes less
+    mutable int _cached_best;
     mutable int _local_best_check_counter;
 
     ModifiedTSPTask() { throw std::runtime_error("Cannot construct ModifiedTSPTask(void)"); }
 
     ModifiedTSPTask(const TSPPath& path, int node)
-        : _path(path), _local_best_check_counter(0) {
+        : _path(path), _cached_best(INT_MAX),
+          _local_best_check_counter(BEST_REFRESH_PERIOD) {
         _path.push(node);
     }
 
-    // 🔹 One-time initial full tour (0 → 1 → ... → 0)
+    // pruning limit: the cached copy, refreshed every BEST_REFRESH_PERIOD
+    // calls instead of hitting the shared line each node
+    int incumbent() const {
+        if (++_local_best_check_counter >= BEST_REFRESH_PERIOD)
+            refreshIncumbent();
+        return _cached_best;
+    }
+
+    void refreshIncumbent() const {
+        _local_best_check_counter = 0;
+        _cached_best = pruneLimit(best_distance.value.load(std::memory_order_acquire));
+    }
+
+    // 🔹 One-time initial incumbent: the supplied seed tour if any, else
+    // nearest neighbour; then 2-opt / Or-opt on top of it
     static void computeInitialBound() {
-        TSPPath p;
-        for (int i = 1; i < TSPPath::full(); ++i) {
-            p.push(i);
+        const int W = TSPPath::MAX_GRAPH;
+        std::vector<int> tour;
+        if (!_seed_tour.empty()) {
+            tour = _seed_tour;
+            updateBestPath(tourToPath(tour));
+        } else {
+            tour = nearestNeighbourTour(TSPPath::full(),
+                TSPPath::distanceRow(0), W, TSPPath::FIRST_NODE);
         }
-        p.push(TSPPath::FIRST_NODE);
-
-        int d = p.distance();
-        best_distance.store(d, std::memory_order_release);
+        localSearch(tour, TSPPath::distanceRow(0), W);
+        updateBestPath(tourToPath(tour));
+    }
 
-        std::lock_guard<std::mutex> lock(best_path_mutex);
-        best_path = p;
+    // 🔹 Ensure initial incumbent exists
+    static void ensureInitialBound() {
+        if (!initial_bound_set.exchange(true, std::memory_order_acq_rel)) {
+            computeInitialBound();
+        }
     }
 
 public:
-    ModifiedTSPTask(int cutoff) : _local_best_check_counter(0) {
-        best_distance.store(INT_MAX, std::memory_order_relaxed);
+    ModifiedTSPTask(int cutoff)
+        : _cached_best(INT_MAX), _local_best_check_counter(BEST_REFRESH_PERIOD) {
+        best_distance.value.store(INT_MAX, std::memory_order_relaxed);
         initial_bound_set.store(false, std::memory_order_relaxed);
-        best_path.maximise();
+        releaseSnapshots();
+        open_bound.store(INT_MAX, std::memory_order_relaxed);
+        _search_start = std::chrono::steady_clock::now();
         _cutoff_size = TSPPath::full() - cutoff;
+        bound_selector.reset();
     }
 
+    // nullptr (default) runs to proven optimality
+    static void setCancellationToken(CancellationToken* token) { _cancel = token; }
+
+    static bool cancelled() { return _cancel && _cancel->cancelled(); }
+
+    // stream every accepted incumbent; an empty function disables it
+    static void setImprovementCallback(const ImprovementCallback& cb) { _on_improvement = cb; }
+
+    // seed the incumbent with a known tour over all full() cities, starting
+    // at FIRST_NODE (see readTour()); an empty vector clears it
+    static void setInitialTour(const std::vector<int>& tour) {
+        if (!tour.empty() && ((int)tour.size() != TSPPath::full()
+                              || tour[0] != TSPPath::FIRST_NODE))
+            throw std::runtime_error("Initial tour does not match the graph");
+        _seed_tour = tour;
+    }
+
+    // 0 (default) searches for the optimum; eps > 0 returns a tour within
+    // a factor 1 + eps of it
+    static void setEpsilon(double eps) { _epsilon = eps > 0 ? eps : 0; }
+
+    // Subtrees whose lower bound reaches this value are pruned: the
+    // incumbent itself, or ceil(incumbent / (1 + eps)) in epsilon mode.
+    static int pruneLimit(int best) {
+        if (_epsilon <= 0 || best == INT_MAX) return best;
+        return (int)std::ceil(best / (1.0 + _epsilon));
+    }
+
+    // Lower bound on every tour, valid whether or not the search finished:
+    // the pruning limit, or the best bound among subtrees dropped on
+    // cancellation.
+    static int provenLowerBound() {
+        int open = open_bound.load(std::memory_order_acquire);
+        int limit = pruneLimit(bestDistance());
+        return open < limit ? open : limit;
+    }
+
+    // strong bound cutoff expressed as a distance from full, like cutoff
+    static void setStrongBoundCutoff(int cutoff) {
+        _strong_bound_cutoff = cutoff;
+    }
+
+    static bool useStrongBound(int path_size) {
+        return path_size < TSPPath::full() - _strong_bound_cutoff;
+    }
+
+    // true: ignore the cutoff and split only when a worker runs out of work
+    static void setLazySplitting(bool on) { _lazy_split = on; }
+
+    // must be false for asymmetric distance matrices
+    static void setSymmetryBreaking(bool on) { _break_symmetry = on; }
+
+    // false: always use the 1-tree bound in shouldPrune() (previous behaviour)
+    static void setAdaptiveBounds(bool on) { _adaptive_bounds = on; }
+
     ~ModifiedTSPTask() override = default;
 
-    TSPPath result() {
-        return best_path;
+    // the published incumbent; valid after the root task has been deleted
+    static TSPPath result() {
+        IncumbentSnapshot* snap = best_snapshot.load(std::memory_order_acquire);
+        if (snap) return snap->path;
+        TSPPath none;
+        none.maximise();
+        return none;
     }
 
+    // free every published snapshot; only call while no worker is running
+    static void releaseSnapshots() {
+        IncumbentSnapshot* snap = best_snapshot.exchange(nullptr, std::memory_order_acq_rel);
+        while (snap) {
+            IncumbentSnapshot* prev = snap->prev;
+            delete snap;
+            snap = prev;
+        }
+    }
+
+    // closed TSPPath for a heuristic tour starting at FIRST_NODE
+    static TSPPath tourToPath(const std::vector<int>& tour) {
+        TSPPath p;
+        for (size_t k = 1; k < tour.size(); ++k) {
+            p.push(tour[k]);
+        }
+        p.push(TSPPath::FIRST_NODE);
+        return p;
+    }
+
+    static int bestDistance() {
+        return best_distance.value.load(std::memory_order_acquire);
+    }
+
+    // Lock-free publication: the snapshot pointer is swapped in with one CAS,
+    // then best_distance is lowered to match. best_distance may briefly lag
+    // above the published tour, which only delays pruning.
     static bool updateBestPath(const TSPPath& candidate) {
         int candidate_dist = candidate.distance();
-        int current_best = best_distance.load(std::memory_order_acquire);
-
-        while (candidate_dist < current_best) {
-            if (best_distance.compare_exchange_weak(
-                    current_best,
-                    candidate_dist,
-                    std::memory_order_acq_rel,
-                    std::memory_order_acquire)) {
-
-                std::lock_guard<std::mutex> lock(best_path_mutex);
-                best_path = candidate;
-                return true;
+        if (candidate_dist >= best_distance.value.load(std::memory_order_acquire))
+            return false;
+
+        IncumbentSnapshot* snap = new IncumbentSnapshot(candidate);
+        IncumbentSnapshot* cur = best_snapshot.load(std::memory_order_acquire);
+        while (true) {
+            if (cur && candidate_dist >= cur->path.distance()) {
+                delete snap;
+                return false;
             }
+            snap->prev = cur;
+            if (best_snapshot.compare_exchange_weak(cur, snap,
+                    std::memory_order_acq_rel, std::memory_order_acquire))
+                break;
+        }
+
+        int current_best = best_distance.value.load(std::memory_order_acquire);
+        while (candidate_dist < current_best &&
+               !best_distance.value.compare_exchange_weak(current_best, candidate_dist,
+                    std::memory_order_acq_rel, std::memory_order_acquire)) {
+        }
+
+        if (_on_improvement) {
+            std::chrono::duration<double> t = std::chrono::steady_clock::now() - _search_start;
+            _on_improvement(snap->path, t.count(), std::this_thread::get_id());
+        }
+        return true;
+    }
+
+    bool shouldPrune() const {
+        int current_best = incumbent();
+        if (!_adaptive_bounds)
+            return estimateLowerBound() >= current_best;
+
+        int depth = _path.size();
+        if (!bound_selector.sampleNow())
+            return lowerBound(bound_selector.choice(depth)) >= current_best;
+
+        // sample: run every bound on this node so their prune rates compare
+        bool pruned = false;
+        for (int k = 0; k < BoundSelector::NUM_BOUNDS; ++k) {
+            BoundSelector::Kind kind = static_cast<BoundSelector::Kind>(k);
+            BoundSelector::clock::time_point t0 = BoundSelector::clock::now();
+            int lb = lowerBound(kind);
+            BoundSelector::clock::time_point t1 = BoundSelector::clock::now();
+            bool p = lb >= current_best;
+            bound_selector.record(depth, kind, BoundSelector::elapsedNs(t0, t1), p);
+            pruned = pruned || p;
         }
-        return false;
+        bound_selector.decide(depth);
+        return pruned;
     }
 
-    bool shouldPrune() const {  
-        return estimateLowerBound() >= best_distance.load(std::memory_order_acquire);
+    int lowerBound(BoundSelector::Kind kind) const {
+        switch (kind) {
+        case BoundSelector::BOUND_SIMPLE:   return simpleLowerBound();
+        case BoundSelector::BOUND_MIN_EDGE: return _path.minEdgeBound();
+        case BoundSelector::BOUND_ONE_TREE: return estimateLowerBound();
+        default:                            return _path.distance();
+        }
+    }
+
+    // cheapest admissible bound: the path must at least return home
+    int simpleLowerBound() const {
+        return _path.distance()
+             + TSPPath::graphDistance(_path.tail(), TSPPath::FIRST_NODE);
     }
 
     int estimateLowerBound() const {
         // Stronger admissible bound using a 1-tree style relaxation:
         // lb = distance(path)
-        //    + MST over remaining nodes (excluding root)
-        //    + two smallest edges from root (choose root = tail) to remaining ∪ {FIRST_NODE}
-        const int n = TSPPath::full();
+        //    + MST over remaining nodes
+        //    + cheapest edge tail -> remaining + cheapest edge remaining -> FIRST_NODE
         int lb = _path.distance();
-
-        // collect remaining nodes (not yet in path)
-        std::vector<int> remaining;
-        remaining.reserve(n);
-        for (int i = 0; i < n; ++i) {
-            if (!_path.contains(i)) remaining.push_back(i);
-        }
-
         int tail = _path.tail();
+        uint32_t remaining = _path.openNodes();
 
-        // MST over remaining nodes (if size >= 2)
-        if (remaining.size() >= 2) {
-            std::vector<bool> vis(remaining.size(), false);
-            vis[0] = true;
-            int visitedCount = 1;
-            while (visitedCount < (int)remaining.size()) {
-                int bestEdge = INT_MAX;
-                int bestJ = -1;
-                for (int uIdx = 0; uIdx < (int)remaining.size(); ++uIdx) {
-                    if (!vis[uIdx]) continue;
-                    int u = remaining[uIdx];
-                    for (int vIdx = 0; vIdx < (int)remaining.size(); ++vIdx) {
-                        if (vis[vIdx]) continue;
-                        int v = remaining[vIdx];
-                        int w = TSPPath::graphDistance(u, v);
-                        if (w < bestEdge) { bestEdge = w; bestJ = vIdx; }
-                    }
-                }
-                if (bestJ < 0 || bestEdge == INT_MAX) break;
-                lb += bestEdge;
-                vis[bestJ] = true;
-                ++visitedCount;
-            }
-        }
+        if (!remaining)
+            return lb + TSPPath::graphDistance(tail, TSPPath::FIRST_NODE);
 
-        // two smallest edges from root (tail) to remaining ∪ {FIRST_NODE}
-        int e1 = INT_MAX, e2 = INT_MAX;
-        for (int v : remaining) {
-            if (v == tail) continue;
-            int w = TSPPath::graphDistance(tail, v);
-            if (w < e1) { e2 = e1; e1 = w; }
-            else if (w < e2) { e2 = w; }
-        }
-        // include FIRST_NODE as candidate to ensure two edges exist when remaining.size() == 1
-        if (TSPPath::FIRST_NODE != tail) {
-            int w = TSPPath::graphDistance(tail, TSPPath::FIRST_NODE);
-            if (w < e1) { e2 = e1; e1 = w; }
-            else if (w < e2) { e2 = w; }
-        }
-        if (e1 != INT_MAX) lb += e1;
-        if (e2 != INT_MAX) lb += e2;
+        // vectorized Prim over the aligned distance rows
+        const int W = TSPPath::MAX_GRAPH;
+        int idx;
+        lb += primMST(TSPPath::distanceRow(0), W, remaining, W);
 
+        // connect the spanning tree to both ends of the open path: the rest
+        // of the tour leaves tail into some remaining node and enters
+        // FIRST_NODE from some remaining node
+        lb += maskedMin(TSPPath::distanceRow(tail), remaining, W, &idx);
+        lb += maskedMin(TSPPath::backColumn(), remaining, W, &idx);
         return lb;
     }
 
-    int split(TaskCollection* collection) override {
-        // 🔹 Ensure initial incumbent exists
-        if (!initial_bound_set.exchange(true, std::memory_order_acq_rel)) {
-            computeInitialBound();
+    // Children of _path that survive symmetry and the O(1) bound, sorted by
+    // that bound (most promising first). Returns how many were stored.
+    // The bounds of all siblings come from one vector pass.
+    int orderedChildren(int* child, int* key, int current_best) const {
+        alignas(64) int bound[TSPPath::MAX_GRAPH];
+        uint32_t alive = _path.childSurvivors(current_best, bound);
+        int m = 0;
+        while (alive) {
+            int i = __builtin_ctz(alive);
+            alive &= alive - 1;
+            if (_break_symmetry && !_path.symmetryAllows(i)) continue;
+            int b = bound[i];
+            int j = m++;
+            for (; j > 0 && key[j-1] > b; --j) {
+                key[j] = key[j-1];
+                child[j] = child[j-1];
+            }
+            key[j] = b;
+            child[j] = i;
         }
+        return m;
+    }
 
-        if (_path.size() >= _cutoff_size) return 0;
-        if (shouldPrune()) return -1;
+    int split(TaskCollection* collection) override {
+        ensureInitialBound();
+        if (cancelled()) { reportOpen(); return -1; }
 
+        // a popped task may have waited a while: start from the current value
+        refreshIncumbent();
+        if (!_lazy_split && _path.size() >= _cutoff_size) return 0;
+        if (shouldPrune()) return -1;
+        // lazy: a shed subtree is solved whole, split further only on demand
+        if (_lazy_split) return 0;
+
+        int child[TSPPath::MAX_GRAPH];
+        int key[TSPPath::MAX_GRAPH];
+        int current_best = _cached_best;
+        int m = orderedChildren(child, key, current_best);
+        bool strong = useStrongBound(_path.size() + 1);
+
+        // push worst first so the LIFO pool pops the most promising child
+        // next; the whole batch goes to the pool in one call
+        Task* batch[TSPPath::MAX_GRAPH];
         int count = 0;
-        int current_best = best_distance.load(std::memory_order_acquire);
-
-        for (int i = 0; i < TSPPath::full(); ++i) {
-            if (!_path.contains(i)) {
-                int new_dist = _path.distance()
-                             + TSPPath::graphDistance(_path.tail(), i);
-                // apply bound with quick estimate
-                if (new_dist + TSPPath::graphDistance(i, TSPPath::FIRST_NODE) < current_best) {
-                    ModifiedTSPTask* t = new ModifiedTSPTask(_path, i);
-                    collection->push(t);
-                    ++count;
-                }
+        for (int k = m - 1; k >= 0; --k) {
+            int i = child[k];
+            // don't enqueue a child that would be pruned as soon as popped
+            if (strong) {
+                _path.push(i);
+                bool pruned = shouldPrune();
+                _path.pop();
+                if (pruned) continue;
             }
+            batch[count++] = new ModifiedTSPTask(_path, i);
+        }
+        collection->pushMany(batch, count);
+        // every child was pruned: nothing left to solve here either
+        return count > 0 ? count : -1;
+    }
+
+    // record the bound of the subtree at _path, which is being abandoned
+    void reportOpen() const {
+        int lb = estimateLowerBound();
+        int cur = open_bound.load(std::memory_order_relaxed);
+        while (lb < cur && !open_bound.compare_exchange_weak(cur, lb,
+                    std::memory_order_acq_rel, std::memory_order_relaxed)) {
         }
-        return count;
     }
 
     void merge(TaskCollection*) override {}
 
+    // Lazy splitting: hand the untried children of the outermost frame that
+    // still has some to the runner as tasks. Those root the biggest
+    // subtrees, so one share keeps an idle worker busy for a while.
+    void shed(Frame* frame, int current_best, WorkSharing* sharing) {
+        Frame* outer = nullptr;
+        for (Frame* f = frame; f; f = f->parent)
+            if (f->next < f->count && f->key[f->next] < current_best) outer = f;
+        if (!outer || TSPPath::full() - (outer->depth + 1) < MIN_SHED_OPEN) return;
+
+        TSPPath prefix = _path;
+        while (prefix.size() > outer->depth) prefix.pop();
+        // worst first, as in split(), so the pool hands out the best one next
+        Task* batch[TSPPath::MAX_GRAPH];
+        int count = 0;
+        for (int k = outer->count - 1; k >= outer->next; --k)
+            if (outer->key[k] < current_best)
+                batch[count++] = new ModifiedTSPTask(prefix, outer->child[k]);
+        outer->count = outer->next;
+        sharing->share(batch, count);
+    }
+
     void solve() override {
+        // root solved directly (DirectTaskRunner) still gets the warm start
+        if (_path.size() == 1) ensureInitialBound();
+        search(nullptr);
+    }
+
+    void search(Frame* parent) {
+        if (cancelled()) { reportOpen(); return; }
+
         if (_path.size() == TSPPath::full()) {
             _path.push(TSPPath::FIRST_NODE);
-            if (_path.distance() < best_distance.load(std::memory_order_acquire)) {
+            if (_path.distance() < incumbent()) {
                 updateBestPath(_path);
+                refreshIncumbent();
             }
             _path.pop();
         } else {
-            int current_best = best_distance.load(std::memory_order_acquire);
-            for (int i = 0; i < TSPPath::full(); ++i) {
-                if (!_path.contains(i)) {
-                    int new_dist = _path.distance()
-                                 + TSPPath::graphDistance(_path.tail(), i);
-                    // prune with simple bound including close-to-start
-                    if (new_dist + TSPPath::graphDistance(i, TSPPath::FIRST_NODE) < current_best) {
-                        _path.push(i);
-                        solve();
-                        _path.pop();
-                        current_best = best_distance.load(std::memory_order_acquire);
-                    }
-                }
+            int child[TSPPath::MAX_GRAPH];
+            int key[TSPPath::MAX_GRAPH];
+            int current_best = incumbent();
+            Frame frame;
+            frame.child = child;
+            frame.key = key;
+            frame.next = 0;
+            frame.count = orderedChildren(child, key, current_best);
+            frame.depth = _path.size();
+            frame.parent = parent;
+            bool strong = useStrongBound(_path.size() + 1);
+            WorkSharing* sharing = _lazy_split ? WorkSharing::current() : nullptr;
+            while (frame.next < frame.count) {
+                int k = frame.next++;
+                // keys are sorted: once one fails the incumbent, all the rest do
+                if (key[k] >= current_best) break;
+                if (sharing && sharing->hungry()) shed(&frame, current_best, sharing);
+                _path.push(child[k]);
+                if (!strong || !shouldPrune())
+                    search(&frame);
+                _path.pop();
+                // this frame's bound covers the siblings not tried yet
+                if (cancelled()) { reportOpen(); return; }
+                current_best = incumbent();
             }
         }
     }
@@ -289,10 +688,24 @@ public:
 
 // static definitions
 TSPGraph* TSPPath::_graph = nullptr;
-std::atomic<int> ModifiedTSPTask::best_distance{INT_MAX};
+TSPPath::Tables TSPPath::_master;
+thread_local const TSPPath::Tables* TSPPath::_tables = &TSPPath::_master;
+NodeReplicas<TSPPath::Tables> TSPPath::_replicas;
+unsigned TSPPath::_generation = 0;
+PaddedAtomicInt ModifiedTSPTask::best_distance(INT_MAX);
 std::atomic<bool> ModifiedTSPTask::initial_bound_set{false};
-TSPPath ModifiedTSPTask::best_path;
-std::mutex ModifiedTSPTask::best_path_mutex;
+std::atomic<IncumbentSnapshot*> ModifiedTSPTask::best_snapshot{nullptr};
+CancellationToken* ModifiedTSPTask::_cancel = nullptr;
+std::atomic<int> ModifiedTSPTask::open_bound{INT_MAX};
 int ModifiedTSPTask::_cutoff_size = INT_MAX;
+int ModifiedTSPTask::_strong_bound_cutoff = 2;
+bool ModifiedTSPTask::_break_symmetry = true;
+BoundSelector ModifiedTSPTask::bound_selector;
+bool ModifiedTSPTask::_adaptive_bounds = true;
+double ModifiedTSPTask::_epsilon = 0;
+std::vector<int> ModifiedTSPTask::_seed_tour;
+bool ModifiedTSPTask::_lazy_split = false;
+ModifiedTSPTask::ImprovementCallback ModifiedTSPTask::_on_improvement;
+std::chrono::steady_clock::time_point ModifiedTSPTask::_search_start;
 
 #endif // MODIFIED_TSPTASK_HPP
\ No newline at end of file
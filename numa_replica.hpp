@@ -0,0 +1,92 @@
+#ifndef NUMA_REPLICA_HPP
+#define NUMA_REPLICA_HPP
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <cstring>
+#include <cstddef>
+#include <sys/mman.h>
+
+// Per-NUMA-node copies of a read-only, trivially copyable T.
+//
+// get(node, ...) returns the copy for node, (re)filling it from master when
+// it is older than generation. Each copy lives in its own mapping and Linux
+// places a page on the node of the thread that first writes it, so get()
+// must be called by a thread already running on that node (a pinned worker);
+// from then on every reader of that copy stays on local memory.
+//
+// With huge pages the mapping is rounded up to 2 MB and backed by reserved
+// hugetlbfs pages when there are any, transparent huge pages otherwise.
+template <class T>
+class NodeReplicas {
+private:
+    static const size_t PAGE = 4096;
+    static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+    struct Replica {
+        T* data;
+        size_t bytes;
+        unsigned generation;
+    };
+
+    std::mutex _mutex;
+    std::vector<Replica> _replicas;   // indexed by node
+    bool _huge;
+
+    static size_t roundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+    T* allocate(size_t& bytes) {
+        void* p = MAP_FAILED;
+        if (_huge) {
+            bytes = roundUp(sizeof(T), HUGE_PAGE);
+#ifdef MAP_HUGETLB
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+            if (p == MAP_FAILED) {
+                p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (p != MAP_FAILED) madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            }
+        } else {
+            bytes = roundUp(sizeof(T), PAGE);
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+public:
+    NodeReplicas() : _huge(false) {}
+
+    ~NodeReplicas() {
+        for (Replica& r : _replicas)
+            if (r.data) munmap(r.data, r.bytes);
+    }
+
+    // applies to copies allocated from now on
+    void setHugePages(bool on) { _huge = on; }
+
+    // only call while no reader of node's copy is running
+    const T* get(int node, const T& master, unsigned generation) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (node >= (int)_replicas.size())
+            _replicas.resize(node + 1, Replica{nullptr, 0, 0});
+        Replica& r = _replicas[node];
+        if (!r.data) {
+            r.data = allocate(r.bytes);
+            r.generation = generation - 1;
+        }
+        if (r.generation != generation) {
+            std::memcpy(static_cast<void*>(r.data), &master, sizeof(T));
+            r.generation = generation;
+        }
+        return r.data;
+    }
+};
+
+#endif // NUMA_REPLICA_HPP
@@ -7,69 +7,255 @@
 #include <functional>
 #include <chrono>
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
 #include "lockfree_stack.hpp"
+#include "idle_parking.hpp"
+#include "topology.hpp"
 
+// Workers are created by the first submit() and then live as long as the
+// runner: between runs they sleep on run_cv, and submit() starts the next run
+// by bumping run_generation. Only stop() (or the destructor) ends them.
+//
+// With a placement policy each worker is pinned to a CPU, and every NUMA node
+// the workers land on gets its own task pool: a worker pushes its children to
+// its home pool and pops from it, touching another node's pool only when its
+// own is dry. Without one there is a single pool and the scheduler decides.
 class ParallelTaskRunner : public TaskRunner {
 private:
-    LockFreeStack task_pool;
+    static const int MAX_POP_BATCH = 32;
+    // empty polls (with a yield each) before an idle worker parks
+    static const int SPIN_LOOPS = 64;
+
+    std::vector<LockFreeStack*> node_pools;   // one per NUMA node in use
+    std::vector<int> worker_home;            // worker -> index into node_pools
+    std::vector<int> worker_cpu;             // worker -> cpu it pins to, -1 = none
+    std::vector<int> worker_node;            // worker -> NUMA node (0 unpinned)
+    std::function<void(int)> worker_init;
+    Topology::Placement _placement;
+    IdleParking parking;
     std::vector<std::thread> workers;
     std::atomic<bool> termination_requested;
     std::atomic<int> active_workers;
     std::atomic<int> tasks_processed;
     std::atomic<int> tasks_created;
+    std::atomic<int> tasks_pruned;
     std::atomic<int> idle_threads;
     std::atomic<int> outstanding_tasks;
     std::atomic<int> total_idle_loops;
     std::atomic<int> total_work_loops;
+    std::atomic<int> finished_workers;
+    std::atomic<int> remote_pops;
+    std::atomic<int> tasks_shared;
+    
+    // workers that found no task, on a line of their own: every level of
+    // every solve() polls it through WorkSharing::hungry()
+    struct alignas(64) HungryCount {
+        std::atomic<int> value;
+    } hungry_workers;
+    
+    // what a worker's tasks see as WorkSharing::current()
+    class Sharing : public WorkSharing {
+    private:
+        ParallelTaskRunner& runner;
+        int home;
+        CountingCollection pool;
+    public:
+        Sharing(ParallelTaskRunner& r, int h)
+            : runner(r), home(h), pool(r.node_pools[h], r.outstanding_tasks) {}
+        // someone is idle and what we shared last is gone already
+        bool hungry() const override {
+            return runner.hungry_workers.value.load(std::memory_order_relaxed) > 0
+                && runner.node_pools[home]->empty();
+        }
+        void share(Task** tasks, int n) override {
+            if (n <= 0) return;
+            // counted before visible, like split() children
+            pool.pushMany(tasks, n);
+            runner.tasks_created.fetch_add(n, std::memory_order_relaxed);
+            runner.tasks_shared.fetch_add(n, std::memory_order_relaxed);
+            runner.parking.wake(n);
+        }
+    };
     
+    // run hand-off between submit()/wait() and the persistent workers
+    std::mutex pool_mutex;
+    std::condition_variable run_cv;
+    std::condition_variable done_cv;
+    unsigned long run_generation;
+    bool shutdown;
+    bool run_active;
+    
+    // anytime mode: after _time_limit seconds (0 = none) the token is raised
+    // and tasks wind down, reporting what they left unexplored
+    CancellationToken cancel_token;
+    double _time_limit;
+    bool _timed_out;
     
     int _num_threads;
+    int _pop_batch;
+    
+    std::chrono::steady_clock::time_point run_start;
+    
+    // Runs on the thread that called wait(): raise the token once the budget
+    // is spent. Workers keep draining the pool so every leftover task gets to
+    // report itself, and terminate through the usual outstanding count.
+    void watchDeadline() {
+        auto deadline = run_start + std::chrono::duration<double>(_time_limit);
+        while (finished_workers.load(std::memory_order_acquire) < _num_threads) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                _timed_out = true;
+                cancel_token.cancel();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
+    void worker_main(int thread_id) {
+        if (worker_cpu[thread_id] >= 0) Topology::pinCurrentThread(worker_cpu[thread_id]);
+        unsigned long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex);
+                run_cv.wait(lock, [&] { return shutdown || run_generation != seen; });
+                if (shutdown) return;
+                seen = run_generation;
+            }
+            if (worker_init) worker_init(worker_node[thread_id]);
+            worker_function(thread_id);
+        }
+    }
+    
+    void startWorkers() {
+        worker_home.assign(_num_threads, 0);
+        worker_cpu.assign(_num_threads, -1);
+        worker_node.assign(_num_threads, 0);
+        if (_placement != Topology::PLACE_NONE) {
+            Topology topology;
+            std::vector<CpuInfo> cpus = topology.placement(_placement, _num_threads);
+            // pools only for the nodes that actually got workers
+            std::vector<int> pool_of(topology.numNodes(), -1);
+            int pools = 0;
+            for (int i = 0; i < (int)cpus.size(); ++i) {
+                int& pool = pool_of[cpus[i].node];
+                if (pool < 0) pool = pools++;
+                worker_home[i] = pool;
+                worker_cpu[i] = cpus[i].cpu;
+                worker_node[i] = cpus[i].node;
+            }
+            while ((int)node_pools.size() < pools) node_pools.push_back(new LockFreeStack());
+        }
+        std::cout << "Creating " << _num_threads << " worker threads";
+        if (node_pools.size() > 1) std::cout << " over " << node_pools.size() << " NUMA nodes";
+        std::cout << "\n";
+        for (int i = 0; i < _num_threads; ++i) {
+            workers.emplace_back(&ParallelTaskRunner::worker_main, this, i);
+        }
+    }
+    
+    bool poolsEmpty() const {
+        for (LockFreeStack* pool : node_pools)
+            if (!pool->empty()) return false;
+        return true;
+    }
+    
+    // up to max tasks from the home pool, or else one from another node's
+    int popWork(int home, Task** out, int max) {
+        LockFreeStack& local = *node_pools[home];
+        int got = max > 1 ? local.popMany(out, max) : ((out[0] = local.pop()) ? 1 : 0);
+        if (got > 0) return got;
+        // last resort: a remote task; its children land in our home pool
+        for (size_t k = 1; k < node_pools.size(); ++k) {
+            LockFreeStack& remote = *node_pools[(home + k) % node_pools.size()];
+            if ((out[0] = remote.pop()) != nullptr) {
+                remote_pops.fetch_add(1, std::memory_order_relaxed);
+                return 1;
+            }
+        }
+        return 0;
+    }
     
     void worker_function(int thread_id) {
         active_workers.fetch_add(1, std::memory_order_relaxed);
+        const int home = worker_home[thread_id];
+        Sharing sharing(*this, home);
+        WorkSharing::current() = &sharing;
         
         int idle_loops = 0;
-        const int MAX_IDLE_LOOPS = 1000;
+        bool hungry = false;
+        
+        // tasks taken from the pool in one popMany(), run in pop() order;
+        // they stay counted in outstanding_tasks until processed
+        Task* batch[MAX_POP_BATCH];
+        int batch_size = 0, batch_next = 0;
         
         while (!termination_requested.load(std::memory_order_relaxed)) {
-            Task* task = task_pool.pop();
+            Task* task = nullptr;
+            if (batch_next < batch_size) {
+                task = batch[batch_next++];
+            } else {
+                batch_size = popWork(home, batch, _pop_batch);
+                batch_next = 0;
+                if (batch_size > 0) task = batch[batch_next++];
+            }
             
             if (task == nullptr) {
                 total_idle_loops.fetch_add(1, std::memory_order_relaxed);
-                idle_loops++;
-                idle_threads.fetch_add(1, std::memory_order_relaxed);
-                
+                if (!hungry) {
+                    hungry = true;
+                    hungry_workers.value.fetch_add(1, std::memory_order_relaxed);
+                }
                 
                 // termination: no tasks outstanding and pool empty
-                if (outstanding_tasks.load(std::memory_order_acquire) == 0 && task_pool.empty()) {
-                    
-                    idle_threads.fetch_sub(1, std::memory_order_relaxed);
+                if (outstanding_tasks.load(std::memory_order_acquire) == 0 && poolsEmpty()) {
                     break;
                 }
                 
-               
-                // light backoff to reduce contention without burning CPU
-                std::this_thread::sleep_for(std::chrono::microseconds(4));
-                idle_threads.fetch_sub(1, std::memory_order_relaxed);
-                
-                // keep yielding rather than hard-exiting; termination
-                // is driven by outstanding_tasks reaching zero
-                if (idle_loops > MAX_IDLE_LOOPS) idle_loops = 0;
+                // spin a little: work usually reappears within a few splits
+                if (++idle_loops < SPIN_LOOPS) {
+                    std::this_thread::yield();
+                    continue;
+                }
                 
-                std::this_thread::yield();
+                // then sleep until a producer pushes or the run ends; the
+                // last look happens after announcing ourselves, so neither
+                // a push nor termination can slip by unnoticed
+                idle_loops = 0;
+                idle_threads.fetch_add(1, std::memory_order_relaxed);
+                uint32_t ticket = parking.prepare();
+                if (!poolsEmpty()
+                    || outstanding_tasks.load(std::memory_order_acquire) == 0
+                    || termination_requested.load(std::memory_order_relaxed))
+                    parking.cancel();
+                else
+                    parking.park(ticket);
+                idle_threads.fetch_sub(1, std::memory_order_relaxed);
                 continue;
             }
             
             idle_loops = 0;  
+            if (hungry) {
+                hungry = false;
+                hungry_workers.value.fetch_sub(1, std::memory_order_relaxed);
+            }
             
            
-            int n = task->split(&task_pool);
+            // new children become outstanding work before they are
+            // visible, so remaining == 0 below can only mean the end
+            CountingCollection counted(node_pools[home], outstanding_tasks);
+            int n = task->split(&counted);
             total_work_loops.fetch_add(1, std::memory_order_relaxed);
             if (n > 0) {
                 tasks_created.fetch_add(n, std::memory_order_relaxed);
-                // new children become outstanding work
-                outstanding_tasks.fetch_add(n, std::memory_order_relaxed);
                 delete task;
+                // this worker pops one child itself unless it still holds
+                // a batch; the rest are for sleepers
+                parking.wake(batch_next < batch_size ? n : n - 1);
+            } else if (n < 0) {
+                // pruned by its bound: nothing to solve
+                delete task;
+                tasks_pruned.fetch_add(1, std::memory_order_relaxed);
             } else {
                 task->solve();
                 delete task;
@@ -79,86 +265,166 @@ private:
             // one logical task (this one) is completed
             int remaining = outstanding_tasks.fetch_sub(1, std::memory_order_acq_rel) - 1;
             if (remaining == 0) {
-                // encourage other threads to exit quickly on next idle check
-                idle_loops = MAX_IDLE_LOOPS + 1;
+                // the run is over: parked workers must see it and exit
+                parking.wakeAll();
             }
         }
         
+        if (hungry) hungry_workers.value.fetch_sub(1, std::memory_order_relaxed);
+        WorkSharing::current() = nullptr;
         active_workers.fetch_sub(1, std::memory_order_relaxed);
+        if (finished_workers.fetch_add(1, std::memory_order_release) + 1 == _num_threads) {
+            // last one out reports the run done (under the lock, so wait()
+            // cannot miss it between its check and its sleep)
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            done_cv.notify_all();
+        }
     }
     
 public:
     ParallelTaskRunner(int num_threads) 
-        : _num_threads(num_threads),
+        : _placement(Topology::PLACE_NONE),
+          _num_threads(num_threads),
           termination_requested(false), 
           active_workers(0),
           tasks_processed(0),
           tasks_created(0),
+          tasks_pruned(0),
           idle_threads(0),
                     outstanding_tasks(0),
                     total_idle_loops(0),
-                    total_work_loops(0) {
+                    total_work_loops(0),
+                    finished_workers(0),
+                    remote_pops(0),
+                    tasks_shared(0),
+                    run_generation(0),
+                    shutdown(false),
+                    run_active(false),
+                    _time_limit(0),
+                    _timed_out(false),
+                    _pop_batch(1) {
         
         if (_num_threads <= 0) {
-            _num_threads = std::thread::hardware_concurrency();
-            if (_num_threads == 0) _num_threads = 4;
+            _num_threads = Topology::defaultThreadCount();
         }
         
+        hungry_workers.value.store(0, std::memory_order_relaxed);
         workers.reserve(_num_threads);
+        node_pools.push_back(new LockFreeStack());
     }
     
     ~ParallelTaskRunner() override {
         stop();
+        for (LockFreeStack* pool : node_pools) delete pool;
     }
     
-    virtual void run(Task* root_task) override {
+    // Start a run on the pool and return at once; wait() collects it. A
+    // run still in flight is waited for first.
+    void submit(Task* root_task) {
         if (!root_task) return;
+        wait();
         termination_requested.store(false, std::memory_order_relaxed);
         tasks_processed.store(0, std::memory_order_relaxed);
         tasks_created.store(0, std::memory_order_relaxed);
+        tasks_pruned.store(0, std::memory_order_relaxed);
         idle_threads.store(0, std::memory_order_relaxed);
         outstanding_tasks.store(1, std::memory_order_relaxed);
         total_idle_loops.store(0, std::memory_order_relaxed);
         total_work_loops.store(0, std::memory_order_relaxed);
+        finished_workers.store(0, std::memory_order_relaxed);
+        remote_pops.store(0, std::memory_order_relaxed);
+        tasks_shared.store(0, std::memory_order_relaxed);
+        hungry_workers.value.store(0, std::memory_order_relaxed);
+        cancel_token.reset();
+        _timed_out = false;
         
+        // the first run sets up placement and the per-node pools
+        if (workers.empty()) startWorkers();
         
-        task_pool.clear();
+        for (LockFreeStack* pool : node_pools) {
+            pool->clear();
+            pool->resetStats();
+        }
+        parking.resetStats();
         
         
-        task_pool.push(root_task);
+        node_pools[0]->push(root_task);
         tasks_created.store(1, std::memory_order_relaxed);
         
         
         startTimer();
-        
-       
-        std::cout << "Creating " << _num_threads << " worker threads\n";
-        
-        for (int i = 0; i < _num_threads; ++i) {
-            workers.emplace_back(&ParallelTaskRunner::worker_function, this, i);
+        run_start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            run_active = true;
+            ++run_generation;
         }
+        run_cv.notify_all();
+    }
+    
+    // block until the submitted run is over (enforcing the time limit)
+    void wait() {
+        if (!run_active) return;
         
+        if (_time_limit > 0) watchDeadline();
         
-        for (auto& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
-            }
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            done_cv.wait(lock, [&] {
+                return finished_workers.load(std::memory_order_acquire) == _num_threads;
+            });
+            run_active = false;
         }
         
         
-        workers.clear();
-        
-        
         stopTimer();
         
         std::cout << "All threads finished. Processed " << tasks_processed.load() 
-                  << " tasks, created " << tasks_created.load() << " tasks.\n";
+                  << " tasks, created " << tasks_created.load()
+                  << " tasks, pruned " << tasks_pruned.load() << " tasks.\n";
         std::cout << "Idle loops: " << total_idle_loops.load() 
-              << ", Work loops: " << total_work_loops.load() << "\n";
+              << ", Work loops: " << total_work_loops.load()
+              << ", Parks: " << parking.parks()
+              << ", Eliminated push/pop pairs: " << eliminated();
+        if (node_pools.size() > 1) std::cout << ", Remote pops: " << remote_pops.load();
+        if (tasks_shared.load() > 0) std::cout << ", Shared: " << tasks_shared.load();
+        std::cout << "\n";
+    }
+    
+    virtual void run(Task* root_task) override {
+        submit(root_task);
+        wait();
     }
     
+    // wall-clock budget for run(), in seconds; 0 disables it
+    void setTimeLimit(double seconds) { _time_limit = seconds; }
+    
+    // tasks a worker takes from the shared pool per CAS (1 = plain pop)
+    void setPopBatch(int n) {
+        _pop_batch = n < 1 ? 1 : (n > MAX_POP_BATCH ? MAX_POP_BATCH : n);
+    }
+    bool timedOut() const { return _timed_out; }
+    
+    // pin workers (and split the pool per NUMA node); takes effect when the
+    // workers are created, i.e. before the first submit()
+    void setPlacement(Topology::Placement p) { _placement = p; }
+    
+    // run by every worker at the start of each run, on its own thread and
+    // after pinning, with its NUMA node: the place to set up node-local data
+    void setWorkerInit(const std::function<void(int node)>& init) { worker_init = init; }
+    
+    // tasks poll this to stop early when the budget runs out
+    CancellationToken& cancellation() { return cancel_token; }
+    
+    // abandon any run in flight and end the worker threads
     void stop() {
         termination_requested.store(true, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            shutdown = true;
+        }
+        run_cv.notify_all();
+        parking.wakeAll();
         
         for (auto& worker : workers) {
             if (worker.joinable()) {
@@ -166,14 +432,23 @@ public:
             }
         }
         workers.clear();
+        run_active = false;
     }
     
     
     int getTasksProcessed() const { return tasks_processed.load(); }
     int getTasksCreated() const { return tasks_created.load(); }
+    int getTasksPruned() const { return tasks_pruned.load(); }
     int getActiveWorkers() const { return active_workers.load(); }
     int getTotalIdleLoops() const { return total_idle_loops.load(); }
     int getTotalWorkLoops() const { return total_work_loops.load(); }
+    int getRemotePops() const { return remote_pops.load(); }
+    int getTasksShared() const { return tasks_shared.load(); }
+    long long eliminated() const {
+        long long sum = 0;
+        for (LockFreeStack* pool : node_pools) sum += pool->eliminated();
+        return sum;
+    }
     
     
    
@@ -1,15 +1,41 @@
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <algorithm>
 #include "modified_tsptask.hpp"
 #include "parallel_task_runner.hpp"
+#include "work_stealing_runner.hpp"
+#include "heuristic_portfolio.hpp"
+#include "tsptour.hpp"
 
 int main(int argc, char** argv) {
     if (argc < 4) {
         std::cerr << "Usage: " << argv[0] << " <file.tsp> <num_cities> <num_threads>\n";
         std::cerr << "Example: " << argv[0] << " example.tsp 10 8\n";
-        std::cerr << "Usage: " << argv[0] << " <file.tsp> <num_cities> <num_threads> [cutoff]\n";
+        std::cerr << "Usage: " << argv[0] << " <file.tsp> <num_cities> <num_threads> [cutoff] [options]\n";
         std::cerr << "Example: " << argv[0] << " example.tsp 12 8 3\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --bound-cutoff=K   apply the strong bound until K cities remain (default 2)\n";
+        std::cerr << "  --fixed-bound      always use the 1-tree bound instead of adaptive selection\n";
+        std::cerr << "  --no-symmetry      explore both directions of every tour\n";
+        std::cerr << "  --heuristic-threads=H  run H local-search threads feeding the incumbent\n";
+        std::cerr << "  --time-limit=SEC   stop after SEC seconds with the best tour, a lower bound and the gap\n";
+        std::cerr << "  --epsilon=E        accept a tour within a factor 1+E of optimal (e.g. 0.01)\n";
+        std::cerr << "  --tour=FILE        seed the incumbent with a TSPLIB .tour or a plain index list\n";
+        std::cerr << "  --improvements=FILE  write each new incumbent as a JSON line (- for stdout)\n";
+        std::cerr << "  --work-stealing    per-thread Chase-Lev deques instead of the shared stack\n";
+        std::cerr << "  --steal-half       work stealing, taking up to half of the victim's tasks\n";
+        std::cerr << "  --pop-batch=N      take up to N tasks from the shared stack per CAS (default 1)\n";
+        std::cerr << "  --repeat=R         solve R times on the same runner, report the mean time\n";
+        std::cerr << "  --lazy-split       no cutoff: a busy worker sheds work only when another is idle\n";
+        std::cerr << "  --pin=POLICY       pin workers: compact, scatter or cores (one per physical core)\n";
+        std::cerr << "  --replicate-graph  give each NUMA node its own copy of the distance tables\n";
+        std::cerr << "  --huge-pages       put those copies on huge pages\n";
         return 1;
     }
 
@@ -17,11 +43,70 @@ int main(int argc, char** argv) {
     int num_cities = std::atoi(argv[2]);
     int num_threads = std::atoi(argv[3]);
     int cutoff = 0;
-    if (argc >= 5) cutoff = std::atoi(argv[4]);
+    int bound_cutoff = 2;
+    bool adaptive_bounds = true;
+    bool break_symmetry = true;
+    int heuristic_threads = 0;
+    double time_limit = 0;
+    double epsilon = 0;
+    std::string tour_file;
+    std::string improvements_file;
+    bool work_stealing = false;
+    bool steal_half = false;
+    int pop_batch = 1;
+    int repeat = 1;
+    Topology::Placement placement = Topology::PLACE_NONE;
+    bool replicate_graph = false;
+    bool lazy_split = false;
+    bool huge_pages = false;
+    for (int a = 4; a < argc; ++a) {
+        const char* arg = argv[a];
+        if (std::strncmp(arg, "--bound-cutoff=", 15) == 0) {
+            bound_cutoff = std::atoi(arg + 15);
+        } else if (std::strcmp(arg, "--fixed-bound") == 0) {
+            adaptive_bounds = false;
+        } else if (std::strcmp(arg, "--no-symmetry") == 0) {
+            break_symmetry = false;
+        } else if (std::strncmp(arg, "--heuristic-threads=", 20) == 0) {
+            heuristic_threads = std::atoi(arg + 20);
+        } else if (std::strncmp(arg, "--time-limit=", 13) == 0) {
+            time_limit = std::atof(arg + 13);
+        } else if (std::strncmp(arg, "--epsilon=", 10) == 0) {
+            epsilon = std::atof(arg + 10);
+        } else if (std::strncmp(arg, "--tour=", 7) == 0) {
+            tour_file = arg + 7;
+        } else if (std::strncmp(arg, "--improvements=", 15) == 0) {
+            improvements_file = arg + 15;
+        } else if (std::strcmp(arg, "--work-stealing") == 0) {
+            work_stealing = true;
+        } else if (std::strcmp(arg, "--steal-half") == 0) {
+            work_stealing = steal_half = true;
+        } else if (std::strncmp(arg, "--pop-batch=", 12) == 0) {
+            pop_batch = std::atoi(arg + 12);
+        } else if (std::strncmp(arg, "--repeat=", 9) == 0) {
+            repeat = std::max(1, std::atoi(arg + 9));
+        } else if (std::strcmp(arg, "--lazy-split") == 0) {
+            lazy_split = true;
+        } else if (std::strcmp(arg, "--replicate-graph") == 0) {
+            replicate_graph = true;
+        } else if (std::strcmp(arg, "--huge-pages") == 0) {
+            replicate_graph = huge_pages = true;
+        } else if (std::strncmp(arg, "--pin=", 6) == 0) {
+            if (!Topology::parsePlacement(arg + 6, placement)) {
+                std::cerr << "Unknown placement: " << (arg + 6) << "\n";
+                return 1;
+            }
+        } else if (arg[0] != '-' || std::isdigit((unsigned char)arg[1])) {
+            cutoff = std::atoi(arg);
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
 
     if (num_threads <= 0) {
-        num_threads = std::thread::hardware_concurrency();
-        if (num_threads == 0) num_threads = 4;
+        // affinity mask and cgroup quota, not the machine's core count
+        num_threads = Topology::defaultThreadCount();
         std::cout << "Using " << num_threads << " threads (auto-detected)\n";
     }
 
@@ -35,33 +120,154 @@ int main(int argc, char** argv) {
     
     std::cout << "Graph size: " << graph.size() << " cities\n";
     std::cout << "Using " << num_threads << " threads\n";
-    std::cout << "Cutoff: " << cutoff << "\n\n";
+    if (lazy_split)
+        std::cout << "Cutoff: none (lazy splitting)\n";
+    else
+        std::cout << "Cutoff: " << cutoff << "\n";
+    if (heuristic_threads > 0)
+        std::cout << "Heuristic threads: " << heuristic_threads << "\n";
+    if (epsilon > 0)
+        std::cout << "Epsilon: " << epsilon << "\n";
+    std::cout << "\n";
     
     TSPPath::setup(&graph);
+    ModifiedTSPTask::setStrongBoundCutoff(bound_cutoff);
+    ModifiedTSPTask::setAdaptiveBounds(adaptive_bounds);
+    ModifiedTSPTask::setSymmetryBreaking(break_symmetry);
+    ModifiedTSPTask::setEpsilon(epsilon);
+    ModifiedTSPTask::setLazySplitting(lazy_split);
+    if (!tour_file.empty()) {
+        try {
+            std::vector<int> seed = readTour(tour_file, graph.size(), TSPPath::FIRST_NODE);
+            ModifiedTSPTask::setInitialTour(seed);
+            std::cout << "Initial tour: " << ModifiedTSPTask::tourToPath(seed) << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid tour file " << tour_file << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
     
-    // Create task with cutoff 0 (split all the way)
-    // Create task with chosen cutoff
-    ModifiedTSPTask* tsp_task = new ModifiedTSPTask(cutoff);
+    // Stream improvements as newline-delimited JSON records. Workers report
+    // concurrently, so records that arrive after a better one are dropped.
+    // With --repeat each run starts a fresh stream, tagged with its index.
+    std::ofstream improvements_out;
+    std::ostream* improvements = nullptr;
+    std::mutex improvements_mutex;
+    int last_written = INT_MAX;
+    int improvements_run = 0;
+    if (!improvements_file.empty()) {
+        if (improvements_file == "-") {
+            improvements = &std::cout;
+        } else {
+            improvements_out.open(improvements_file);
+            if (!improvements_out) {
+                std::cerr << "Cannot open " << improvements_file << "\n";
+                return 1;
+            }
+            improvements = &improvements_out;
+        }
+        ModifiedTSPTask::setImprovementCallback(
+            [&](const TSPPath& tour, double seconds, std::thread::id thread) {
+                std::lock_guard<std::mutex> lock(improvements_mutex);
+                if (tour.distance() >= last_written) return;
+                last_written = tour.distance();
+                std::ostringstream os;
+                os << "{";
+                if (repeat > 1) os << "\"run\":" << improvements_run << ",";
+                os << "\"distance\":" << tour.distance()
+                   << ",\"time\":" << std::fixed << std::setprecision(6) << seconds
+                   << ",\"thread\":\"" << thread << "\",\"tour\":[";
+                for (int i = 0; i < tour.size(); ++i)
+                    os << (i ? "," : "") << tour.node(i);
+                os << "]}";
+                *improvements << os.str() << std::endl;
+            });
+    }
     
     // Run parallel version
     std::cout << "\nRunning parallel version with " << num_threads << " threads..." << std::endl;
     
     ParallelTaskRunner parallel_runner(num_threads);
+    WorkStealingTaskRunner stealing_runner(num_threads, steal_half);
+    parallel_runner.setTimeLimit(time_limit);
+    parallel_runner.setPopBatch(pop_batch);
+    stealing_runner.setTimeLimit(time_limit);
+    parallel_runner.setPlacement(placement);
+    stealing_runner.setPlacement(placement);
+    if (replicate_graph) {
+        TSPPath::setReplicaHugePages(huge_pages);
+        parallel_runner.setWorkerInit(TSPPath::useNodeReplica);
+        stealing_runner.setWorkerInit(TSPPath::useNodeReplica);
+    }
+    ModifiedTSPTask::setCancellationToken(work_stealing ? &stealing_runner.cancellation()
+                                                        : &parallel_runner.cancellation());
+    HeuristicPortfolio portfolio;
     
+    // Back-to-back runs reuse the runner, and with it ParallelTaskRunner's
+    // worker threads; each root task resets the search state.
     auto start_time = std::chrono::high_resolution_clock::now();
-    parallel_runner.run(tsp_task);
+    for (int r = 0; r < repeat; ++r) {
+        // Create task with chosen cutoff; the runner deletes it when done,
+        // the result stays in ModifiedTSPTask's shared state
+        ModifiedTSPTask* tsp_task = new ModifiedTSPTask(cutoff);
+        {
+            std::lock_guard<std::mutex> lock(improvements_mutex);
+            last_written = INT_MAX;
+            improvements_run = r;
+        }
+        portfolio.start(heuristic_threads);
+        if (work_stealing)
+            stealing_runner.run(tsp_task);
+        else
+            parallel_runner.run(tsp_task);
+        portfolio.stop();
+    }
     auto end_time = std::chrono::high_resolution_clock::now();
     
-    double parallel_time = std::chrono::duration<double>(end_time - start_time).count();
+    double parallel_time = std::chrono::duration<double>(end_time - start_time).count() / repeat;
     
     
-    TSPPath best_path = tsp_task->result();
+    TSPPath best_path = ModifiedTSPTask::result();
     
     std::cout << "\n=== PARALLEL RESULTS ===" << std::endl;
     std::cout << "Best distance: " << best_path.distance() << std::endl;
     std::cout << "Time: " << std::fixed << std::setprecision(3) << parallel_time << " seconds" << std::endl;
-    std::cout << "Tasks processed: " << parallel_runner.getTasksProcessed() << std::endl;
-    std::cout << "Tasks created: " << parallel_runner.getTasksCreated() << std::endl;
+    if (repeat > 1)
+        std::cout << "Runs: " << repeat << " (mean time per run above)" << std::endl;
+    if (work_stealing) {
+        std::cout << "Tasks processed: " << stealing_runner.getTasksProcessed() << std::endl;
+        std::cout << "Tasks created: " << stealing_runner.getTasksCreated() << std::endl;
+        std::cout << "Tasks pruned: " << stealing_runner.getTasksPruned() << std::endl;
+        std::cout << "Steals: " << stealing_runner.getSteals() << std::endl;
+    } else {
+        std::cout << "Tasks processed: " << parallel_runner.getTasksProcessed() << std::endl;
+        std::cout << "Tasks created: " << parallel_runner.getTasksCreated() << std::endl;
+        std::cout << "Tasks pruned: " << parallel_runner.getTasksPruned() << std::endl;
+    }
+    if (heuristic_threads > 0)
+        std::cout << "Heuristic improvements: " << portfolio.getImprovements() << std::endl;
+    ModifiedTSPTask::setCancellationToken(nullptr);
+    ModifiedTSPTask::setImprovementCallback(ModifiedTSPTask::ImprovementCallback());
+    
+    int lower = ModifiedTSPTask::provenLowerBound();
+    if (epsilon > 0 && time_limit <= 0) {
+        std::cout << "Lower bound: " << lower << " (within "
+                  << std::setprecision(2) << epsilon * 100 << "% of optimal)" << std::endl;
+    }
+    
+    if (time_limit > 0) {
+        // anytime mode: report the tour and how far from optimal it can be
+        double gap = best_path.distance() > 0
+                   ? 100.0 * (best_path.distance() - lower) / best_path.distance() : 0.0;
+        std::cout << "\n=== ANYTIME RESULTS ===" << std::endl;
+        bool timed_out = work_stealing ? stealing_runner.timedOut() : parallel_runner.timedOut();
+        std::cout << (timed_out ? "Time limit reached" : "Search completed")
+                  << " (limit " << std::setprecision(3) << time_limit << " s)" << std::endl;
+        std::cout << "Best tour: " << best_path << std::endl;
+        std::cout << "Lower bound: " << lower << std::endl;
+        std::cout << "Gap: " << std::setprecision(2) << gap << "%" << std::endl;
+        return 0;
+    }
     
     
     std::cout << "\nRunning sequential version for comparison..." << std::endl;
@@ -74,15 +280,20 @@ int main(int argc, char** argv) {
     end_time = std::chrono::high_resolution_clock::now();
     
     double seq_time = std::chrono::duration<double>(end_time - start_time).count();
-    TSPPath seq_best = seq_task.result();
+    TSPPath seq_best = ModifiedTSPTask::result();
     
     std::cout << "\n=== SEQUENTIAL RESULTS ===" << std::endl;
     std::cout << "Best distance: " << seq_best.distance() << std::endl;
     std::cout << "Time: " << std::fixed << std::setprecision(3) << seq_time << " seconds" << std::endl;
     
-    // Verify results match
+    // Verify results match (in epsilon mode both runs only need to be
+    // within the guarantee of each other)
     if (best_path.distance() == seq_best.distance()) {
         std::cout << "\n✓ Results match! Parallel solution is correct." << std::endl;
+    } else if (epsilon > 0
+               && best_path.distance() <= (1 + epsilon) * seq_best.distance()
+               && seq_best.distance() <= (1 + epsilon) * best_path.distance()) {
+        std::cout << "\n✓ Results agree within epsilon." << std::endl;
     } else {
         std::cout << "\n✗ ERROR: Results don't match!" << std::endl;
         std::cout << "Parallel: " << best_path.distance() << std::endl;
@@ -0,0 +1,142 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include <cstdint>
+#include <climits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Vector kernels for the branch-and-bound hot loops. Every kernel has an
+// AVX-512 and an AVX2 version, picked at compile time (-march=native), and a
+// scalar fallback. Arrays are 64-byte aligned and padded to a multiple of 16
+// lanes by the caller.
+
+// Bound of every child of a path in one pass:
+//   key[j] = base + row[j] + max(back[j], (c - min2[j]) >> 1)
+// with base = path distance, row = distances from the tail, back = distances
+// to FIRST_NODE and c - min2[j] the doubled min-edge sum left after node j.
+// Returns the bitmask of lanes whose key is below best.
+inline uint32_t siblingBounds(const int* row, const int* back, const int* min2,
+                              int base, int c, int best, int* key, int width) {
+    uint32_t mask = 0;
+#if defined(__AVX512F__)
+    const __m512i vbase = _mm512_set1_epi32(base);
+    const __m512i vc = _mm512_set1_epi32(c);
+    const __m512i vbest = _mm512_set1_epi32(best);
+    for (int j = 0; j < width; j += 16) {
+        __m512i r = _mm512_load_si512(row + j);
+        __m512i b = _mm512_load_si512(back + j);
+        __m512i h = _mm512_srai_epi32(_mm512_sub_epi32(vc, _mm512_load_si512(min2 + j)), 1);
+        __m512i k = _mm512_add_epi32(_mm512_add_epi32(vbase, r), _mm512_max_epi32(b, h));
+        _mm512_store_si512(key + j, k);
+        mask |= (uint32_t)_mm512_cmplt_epi32_mask(k, vbest) << j;
+    }
+#elif defined(__AVX2__)
+    const __m256i vbase = _mm256_set1_epi32(base);
+    const __m256i vc = _mm256_set1_epi32(c);
+    const __m256i vbest = _mm256_set1_epi32(best);
+    for (int j = 0; j < width; j += 8) {
+        __m256i r = _mm256_load_si256((const __m256i*)(row + j));
+        __m256i b = _mm256_load_si256((const __m256i*)(back + j));
+        __m256i m = _mm256_load_si256((const __m256i*)(min2 + j));
+        __m256i h = _mm256_srai_epi32(_mm256_sub_epi32(vc, m), 1);
+        __m256i k = _mm256_add_epi32(_mm256_add_epi32(vbase, r), _mm256_max_epi32(b, h));
+        _mm256_store_si256((__m256i*)(key + j), k);
+        __m256i lt = _mm256_cmpgt_epi32(vbest, k);
+        mask |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(lt)) << j;
+    }
+#else
+    for (int j = 0; j < width; ++j) {
+        int h = (c - min2[j]) >> 1;
+        int k = base + row[j] + (back[j] > h ? back[j] : h);
+        key[j] = k;
+        if (k < best) mask |= 1u << j;
+    }
+#endif
+    return mask;
+}
+
+// Minimum of v[j] over the lanes whose bit is set in lanes; the lowest such
+// lane holding the minimum goes to *index. lanes must not be empty.
+inline int maskedMin(const int* v, uint32_t lanes, int width, int* index) {
+    int best = INT_MAX;
+#if defined(__AVX512F__)
+    __m512i vmin = _mm512_set1_epi32(INT_MAX);
+    for (int j = 0; j < width; j += 16)
+        vmin = _mm512_mask_min_epi32(vmin, (__mmask16)(lanes >> j), vmin,
+                                     _mm512_load_si512(v + j));
+    best = _mm512_reduce_min_epi32(vmin);
+    const __m512i vbest = _mm512_set1_epi32(best);
+    for (int j = 0; j < width; j += 16) {
+        uint32_t hit = _mm512_mask_cmpeq_epi32_mask((__mmask16)(lanes >> j),
+                                                    _mm512_load_si512(v + j), vbest);
+        if (hit) { *index = j + __builtin_ctz(hit); break; }
+    }
+#elif defined(__AVX2__)
+    const __m256i bitsel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i vmax = _mm256_set1_epi32(INT_MAX);
+    __m256i vmin = vmax;
+    for (int j = 0; j < width; j += 8) {
+        __m256i sel = _mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)(lanes >> j)), bitsel), bitsel);
+        __m256i k = _mm256_blendv_epi8(vmax, _mm256_load_si256((const __m256i*)(v + j)), sel);
+        vmin = _mm256_min_epi32(vmin, k);
+    }
+    vmin = _mm256_min_epi32(vmin, _mm256_permute2x128_si256(vmin, vmin, 1));
+    vmin = _mm256_min_epi32(vmin, _mm256_shuffle_epi32(vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmin = _mm256_min_epi32(vmin, _mm256_shuffle_epi32(vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+    best = _mm256_cvtsi256_si32(vmin);
+    for (int j = 0; j < width; j += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i*)(v + j)), vmin);
+        uint32_t hit = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq))
+                     & ((lanes >> j) & 0xFF);
+        if (hit) { *index = j + __builtin_ctz(hit); break; }
+    }
+#else
+    for (int j = 0; j < width; ++j) {
+        if (((lanes >> j) & 1u) && v[j] < best) { best = v[j]; *index = j; }
+    }
+#endif
+    return best;
+}
+
+// key[j] = min(key[j], row[j]) over all lanes
+inline void minInto(int* key, const int* row, int width) {
+#if defined(__AVX512F__)
+    for (int j = 0; j < width; j += 16)
+        _mm512_store_si512(key + j, _mm512_min_epi32(_mm512_load_si512(key + j),
+                                                     _mm512_load_si512(row + j)));
+#elif defined(__AVX2__)
+    for (int j = 0; j < width; j += 8)
+        _mm256_store_si256((__m256i*)(key + j),
+            _mm256_min_epi32(_mm256_load_si256((const __m256i*)(key + j)),
+                             _mm256_load_si256((const __m256i*)(row + j))));
+#else
+    for (int j = 0; j < width; ++j)
+        if (row[j] < key[j]) key[j] = row[j];
+#endif
+}
+
+// Weight of the minimum spanning tree over the nodes set in nodes (Prim with
+// a key array). dist is row-major with the given stride; rows are aligned.
+inline int primMST(const int* dist, int stride, uint32_t nodes, int width) {
+    if (!nodes || !(nodes & (nodes - 1))) return 0;
+    alignas(64) int key[64];
+    int root = __builtin_ctz(nodes);
+    uint32_t left = nodes & ~(1u << root);
+    for (int j = 0; j < width; ++j) key[j] = dist[root * stride + j];
+
+    int total = 0;
+    while (true) {
+        int u = -1;
+        total += maskedMin(key, left, width, &u);
+        left &= ~(1u << u);
+        if (!left) break;
+        minInto(key, dist + u * stride, width);
+    }
+    return total;
+}
+
+#endif // SIMD_KERNELS_HPP
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <chrono>
+#include <atomic>
 #include <vector>  
 #include <stdexcept>  
 
@@ -29,6 +30,22 @@ public:
 	virtual void push(Task* t) = 0;
 	virtual Task* pop() = 0;
 	virtual void clear() = 0;
+	// push(tasks[0]) ... push(tasks[n-1]), so tasks[n-1] ends up on top;
+	// concurrent collections override these to publish a batch at once
+	virtual void pushMany(Task** tasks, int n) {
+		for (int i = 0; i < n; i++)
+			push(tasks[i]);
+	}
+	// up to max tasks in pop() order; returns how many were taken
+	virtual int popMany(Task** out, int max) {
+		int n = 0;
+		while (n < max && size() > 0) {
+			Task* t = pop();
+			if (!t) break;
+			out[n++] = t;
+		}
+		return n;
+	}
     virtual ~TaskCollection() = default;  
 };
 
@@ -74,6 +91,67 @@ public:
 	void clear() override { _size = 0; }
 };
 
+// Forwards to another collection, adding every task pushed to a runner's
+// outstanding count before the task becomes visible there. Runners split
+// into one, so a thief can never finish a child (and take the count to zero)
+// before that child is counted.
+class CountingCollection : public TaskCollection {
+private:
+	TaskCollection* _target;
+	std::atomic<int>& _outstanding;
+	int _pushed;
+public:
+	CountingCollection(TaskCollection* target, std::atomic<int>& outstanding)
+		: _target(target), _outstanding(outstanding), _pushed(0) {}
+	// tasks added to the count so far
+	int pushed() const { return _pushed; }
+	int size() const override { return _target->size(); }
+	Task* operator[](int i) override { return (*_target)[i]; }
+	void push(Task* t) override {
+		_outstanding.fetch_add(1, std::memory_order_relaxed);
+		_pushed ++;
+		_target->push(t);
+	}
+	void pushMany(Task** tasks, int n) override {
+		if (n <= 0) return;
+		_outstanding.fetch_add(n, std::memory_order_relaxed);
+		_pushed += n;
+		_target->pushMany(tasks, n);
+	}
+	Task* pop() override { return _target->pop(); }
+	int popMany(Task** out, int max) override { return _target->popMany(out, max); }
+	void clear() override { _target->clear(); }
+};
+
+// Cooperative cancellation shared by a runner and the tasks it runs: the
+// runner raises it, tasks poll it and wind down on their own.
+class CancellationToken {
+private:
+	std::atomic<bool> _cancelled;
+public:
+	CancellationToken() : _cancelled(false) {}
+	void cancel() { _cancelled.store(true, std::memory_order_release); }
+	void reset() { _cancelled.store(false, std::memory_order_relaxed); }
+	bool cancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+};
+
+// Lazy splitting: lets a task inside solve() hand part of its remaining
+// work back to the runner, but only while some worker is idle. A runner
+// installs one per worker thread for the duration of a run; tasks find it
+// through current(), which is nullptr on threads outside a runner.
+class WorkSharing {
+public:
+	// cheap, meant to be polled at every level of a search
+	virtual bool hungry() const = 0;
+	// publish n new tasks, accounted for like split() children
+	virtual void share(Task** tasks, int n) = 0;
+	virtual ~WorkSharing() = default;
+	static WorkSharing*& current() {
+		static thread_local WorkSharing* sharing = nullptr;
+		return sharing;
+	}
+};
+
 class TaskRunner {
 private:
 	std::chrono::time_point<std::chrono::high_resolution_clock> _start, _stop;
@@ -0,0 +1,216 @@
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#endif
+
+struct CpuInfo {
+    int cpu;       // OS cpu number
+    int core;      // core_id, unique only within a package
+    int package;   // physical_package_id (socket)
+    int node;      // dense NUMA node index, 0 .. numNodes()-1
+    int smt;       // rank of this hardware thread within its core
+};
+
+// The CPUs this process may run on (its affinity mask), with their core,
+// socket and NUMA node as reported by sysfs, and the thread placements
+// built from them. Without sysfs (or off Linux) every CPU is its own core
+// on node 0, and pinning is a no-op.
+class Topology {
+public:
+    enum Placement {
+        PLACE_NONE,      // let the scheduler decide
+        PLACE_COMPACT,   // fill a node, core by core, hyperthreads together
+        PLACE_SCATTER,   // round-robin over nodes, distinct cores first
+        PLACE_CORES      // one thread per physical core, compact order
+    };
+
+private:
+    std::vector<CpuInfo> _cpus;   // compact order: node, package, core, cpu
+    int _num_nodes;
+
+    static int readInt(const std::string& path, int fallback) {
+        std::ifstream in(path);
+        int v;
+        return (in >> v) ? v : fallback;
+    }
+
+    // "0-3,8,10-11" -> 0 1 2 3 8 10 11
+    static std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty() || range == "\n") continue;
+            size_t dash = range.find('-');
+            int lo = std::atoi(range.c_str());
+            int hi = dash == std::string::npos ? lo : std::atoi(range.c_str() + dash + 1);
+            for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    static std::vector<int> allowedCpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof set, &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+#endif
+        if (cpus.empty()) {
+            int n = (int)std::thread::hardware_concurrency();
+            for (int c = 0; c < (n > 0 ? n : 1); ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    void discover() {
+        std::vector<int> allowed = allowedCpus();
+        std::vector<int> node_of(allowed.empty() ? 1 : allowed.back() + 1, -1);
+        _num_nodes = 0;
+#ifdef __linux__
+        // sysfs node ids may be sparse; renumber the ones we can use densely
+        std::vector<int> node_ids;
+        if (DIR* dir = opendir("/sys/devices/system/node")) {
+            while (dirent* e = readdir(dir)) {
+                int id;
+                if (std::strncmp(e->d_name, "node", 4) == 0 && std::sscanf(e->d_name + 4, "%d", &id) == 1)
+                    node_ids.push_back(id);
+            }
+            closedir(dir);
+        }
+        std::sort(node_ids.begin(), node_ids.end());
+        for (int id : node_ids) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            std::getline(in, list);
+            bool used = false;
+            for (int c : parseCpuList(list)) {
+                if (c < (int)node_of.size() && node_of[c] < 0
+                    && std::find(allowed.begin(), allowed.end(), c) != allowed.end()) {
+                    node_of[c] = _num_nodes;
+                    used = true;
+                }
+            }
+            if (used) ++_num_nodes;
+        }
+#endif
+        if (_num_nodes == 0) _num_nodes = 1;
+
+        for (int c : allowed) {
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+            CpuInfo info;
+            info.cpu = c;
+            info.core = readInt(base + "core_id", c);
+            info.package = readInt(base + "physical_package_id", 0);
+            info.node = node_of[c] < 0 ? 0 : node_of[c];
+            info.smt = 0;
+            _cpus.push_back(info);
+        }
+        std::sort(_cpus.begin(), _cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            if (a.node != b.node) return a.node < b.node;
+            if (a.package != b.package) return a.package < b.package;
+            if (a.core != b.core) return a.core < b.core;
+            return a.cpu < b.cpu;
+        });
+        for (size_t i = 1; i < _cpus.size(); ++i) {
+            const CpuInfo& p = _cpus[i - 1];
+            if (p.package == _cpus[i].package && p.core == _cpus[i].core)
+                _cpus[i].smt = p.smt + 1;
+        }
+    }
+
+public:
+    Topology() { discover(); }
+
+    const std::vector<CpuInfo>& cpus() const { return _cpus; }
+    int numNodes() const { return _num_nodes; }
+
+    // the CPU for each of num_threads threads (wrapping around when there
+    // are more threads than CPUs); empty for PLACE_NONE
+    std::vector<CpuInfo> placement(Placement p, int num_threads) const {
+        std::vector<CpuInfo> order;
+        if (p == PLACE_COMPACT) {
+            order = _cpus;
+        } else if (p == PLACE_CORES) {
+            for (const CpuInfo& c : _cpus)
+                if (c.smt == 0) order.push_back(c);
+        } else if (p == PLACE_SCATTER) {
+            // per node: first hardware thread of every core, then the second...
+            std::vector<std::vector<CpuInfo>> per_node(_num_nodes);
+            for (const CpuInfo& c : _cpus) per_node[c.node].push_back(c);
+            for (auto& list : per_node)
+                std::stable_sort(list.begin(), list.end(),
+                    [](const CpuInfo& a, const CpuInfo& b) { return a.smt < b.smt; });
+            for (size_t k = 0; order.size() < _cpus.size(); ++k)
+                for (auto& list : per_node)
+                    if (k < list.size()) order.push_back(list[k]);
+        }
+        std::vector<CpuInfo> result;
+        if (order.empty()) return result;
+        for (int t = 0; t < num_threads; ++t)
+            result.push_back(order[t % order.size()]);
+        return result;
+    }
+
+    static bool parsePlacement(const std::string& name, Placement& p) {
+        if (name == "none") p = PLACE_NONE;
+        else if (name == "compact") p = PLACE_COMPACT;
+        else if (name == "scatter") p = PLACE_SCATTER;
+        else if (name == "cores") p = PLACE_CORES;
+        else return false;
+        return true;
+    }
+
+    // Threads worth running: the CPUs in our affinity mask, capped by the
+    // cgroup CPU quota (rounded up) when a container sets one.
+    static int defaultThreadCount() {
+        int n = (int)allowedCpus().size();
+#ifdef __linux__
+        long quota = -1, period = 0;
+        std::ifstream v2("/sys/fs/cgroup/cpu.max");
+        std::string q;
+        if (v2 >> q >> period) {
+            if (q != "max") quota = std::atol(q.c_str());
+        } else {
+            quota = readInt("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", -1);
+            period = readInt("/sys/fs/cgroup/cpu/cpu.cfs_period_us", 0);
+        }
+        if (quota > 0 && period > 0) {
+            int limit = (int)((quota + period - 1) / period);
+            if (limit < n) n = limit;
+        }
+#endif
+        return n > 0 ? n : 1;
+    }
+
+    static bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+};
+
+#endif // TOPOLOGY_HPP
@@ -0,0 +1,141 @@
+#ifndef TSP_HEURISTICS_HPP
+#define TSP_HEURISTICS_HPP
+
+#include <vector>
+#include <climits>
+#include <random>
+#include <algorithm>
+
+// Construction and local-search heuristics used to warm-start the
+// branch-and-bound with a good incumbent. Tours are closed cycles stored as
+// the sequence of the n cities starting at tour[0]; the edge back to tour[0]
+// is implicit. dist is a row-major symmetric matrix with the given stride.
+
+inline int tourLength(const std::vector<int>& tour, const int* dist, int stride) {
+    int n = (int)tour.size();
+    int len = 0;
+    for (int k = 0; k < n; ++k)
+        len += dist[tour[k] * stride + tour[(k + 1) % n]];
+    return len;
+}
+
+// Greedy tour: always move to the closest unvisited city.
+inline std::vector<int> nearestNeighbourTour(int n, const int* dist, int stride, int start) {
+    std::vector<int> tour;
+    std::vector<bool> used(n, false);
+    tour.reserve(n);
+    tour.push_back(start);
+    used[start] = true;
+    for (int k = 1; k < n; ++k) {
+        const int* row = dist + tour.back() * stride;
+        int best = -1;
+        for (int v = 0; v < n; ++v)
+            if (!used[v] && (best < 0 || row[v] < row[best])) best = v;
+        tour.push_back(best);
+        used[best] = true;
+    }
+    return tour;
+}
+
+// One pass of first-improvement 2-opt. tour[0] never moves.
+inline bool twoOptPass(std::vector<int>& tour, const int* dist, int stride) {
+    int n = (int)tour.size();
+    bool improved = false;
+    for (int i = 0; i < n - 2; ++i) {
+        int a = tour[i], b = tour[i + 1];
+        for (int j = i + 2; j < n; ++j) {
+            int c = tour[j], d = tour[(j + 1) % n];
+            if (d == a) continue;
+            int delta = dist[a * stride + c] + dist[b * stride + d]
+                      - dist[a * stride + b] - dist[c * stride + d];
+            if (delta < 0) {
+                for (int l = i + 1, r = j; l < r; ++l, --r) {
+                    int t = tour[l]; tour[l] = tour[r]; tour[r] = t;
+                }
+                b = tour[i + 1];
+                improved = true;
+            }
+        }
+    }
+    return improved;
+}
+
+// One pass of Or-opt: move a segment of 1 to 3 cities, possibly reversed,
+// to the best other position. tour[0] never moves.
+inline bool orOptPass(std::vector<int>& tour, const int* dist, int stride) {
+    int n = (int)tour.size();
+    bool improved = false;
+    for (int len = 1; len <= 3 && len < n - 2; ++len) {
+        for (int i = 1; i + len - 1 < n; ++i) {
+            int s0 = tour[i], s1 = tour[i + len - 1];
+            int prev = tour[i - 1], next = tour[(i + len) % n];
+            int gain = dist[prev * stride + s0] + dist[s1 * stride + next]
+                     - dist[prev * stride + next];
+
+            int best = 0, best_j = -1;
+            bool best_rev = false;
+            for (int j = 0; j < n; ++j) {
+                // insert between tour[j] and tour[j+1], both outside the segment
+                if (j >= i - 1 && j <= i + len - 1) continue;
+                int a = tour[j], b = tour[(j + 1) % n];
+                int fwd = dist[a * stride + s0] + dist[s1 * stride + b] - dist[a * stride + b];
+                int rev = dist[a * stride + s1] + dist[s0 * stride + b] - dist[a * stride + b];
+                if (fwd - gain < best) { best = fwd - gain; best_j = j; best_rev = false; }
+                if (rev - gain < best) { best = rev - gain; best_j = j; best_rev = true; }
+            }
+            if (best_j < 0) continue;
+
+            std::vector<int> seg(tour.begin() + i, tour.begin() + i + len);
+            if (best_rev) std::vector<int>(seg.rbegin(), seg.rend()).swap(seg);
+            std::vector<int> next_tour;
+            next_tour.reserve(n);
+            for (int k = 0; k < n; ++k) {
+                if (k >= i && k < i + len) continue;
+                next_tour.push_back(tour[k]);
+                if (k == best_j) next_tour.insert(next_tour.end(), seg.begin(), seg.end());
+            }
+            tour.swap(next_tour);
+            improved = true;
+        }
+    }
+    return improved;
+}
+
+// Alternate 2-opt and Or-opt until neither improves the tour.
+inline void localSearch(std::vector<int>& tour, const int* dist, int stride) {
+    if (tour.size() < 4) return;
+    bool improved = true;
+    while (improved) {
+        improved = twoOptPass(tour, dist, stride);
+        improved = orOptPass(tour, dist, stride) || improved;
+    }
+}
+
+// Rotate a cycle so that node comes first.
+inline void rotateToFront(std::vector<int>& tour, int node) {
+    std::vector<int>::iterator it = std::find(tour.begin(), tour.end(), node);
+    if (it != tour.end()) std::rotate(tour.begin(), it, tour.end());
+}
+
+// Double-bridge kick: cut the tour into A B C D and reconnect as A C B D.
+// The first city stays in place; tours shorter than 8 are left alone.
+template <class RNG>
+inline void doubleBridge(std::vector<int>& tour, RNG& rng) {
+    int n = (int)tour.size();
+    if (n < 8) return;
+    std::uniform_int_distribution<int> pick(1, n - 1);
+    int cut[3];
+    do {
+        cut[0] = pick(rng); cut[1] = pick(rng); cut[2] = pick(rng);
+        std::sort(cut, cut + 3);
+    } while (cut[0] == cut[1] || cut[1] == cut[2]);
+    std::vector<int> next;
+    next.reserve(n);
+    next.insert(next.end(), tour.begin(), tour.begin() + cut[0]);
+    next.insert(next.end(), tour.begin() + cut[1], tour.begin() + cut[2]);
+    next.insert(next.end(), tour.begin() + cut[0], tour.begin() + cut[1]);
+    next.insert(next.end(), tour.begin() + cut[2], tour.end());
+    tour.swap(next);
+}
+
+#endif // TSP_HEURISTICS_HPP
@@ -0,0 +1,74 @@
+#ifndef TSPTOUR_HPP
+#define TSPTOUR_HPP
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Reads a tour over the first n cities of a graph, either in TSPLIB .tour
+// format (1-based indices after TOUR_SECTION, ended by -1 or EOF) or as a
+// plain whitespace-separated list of 0-based indices, as printed by the
+// solvers. A trailing repeat of the first city is accepted in both. The
+// tour must visit every city exactly once; it is returned rotated so that
+// first_node comes first.
+inline std::vector<int> readTour(const std::string& filename, int n, int first_node) {
+	std::ifstream in(filename);
+	if (!in)
+		throw std::runtime_error("Cannot open tour file: " + filename);
+
+	std::vector<int> tour;
+	bool tsplib = false;
+	bool inSection = false;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.find("TOUR_SECTION") != std::string::npos) {
+			tsplib = inSection = true;
+			continue;
+		}
+		// solver output "{distance: 0, 4, ...}": drop the distance
+		size_t brace = line.find('{');
+		if (!inSection && brace != std::string::npos && line.find(':') != std::string::npos)
+			line.erase(0, line.find(':', brace) + 1);
+		if (!inSection) {
+			// header keywords ("NAME:", "TYPE: TOUR", ...) mark a TSPLIB file
+			if (line.find(':') != std::string::npos) { tsplib = true; continue; }
+			if (tsplib) continue;
+		}
+		if (line == "EOF") break;
+		for (char& c : line)
+			if (c == ',' || c == '{' || c == '}') c = ' ';
+		std::stringstream ss(line);
+		int city;
+		bool done = false;
+		while (ss >> city) {
+			if (city == -1) { done = true; break; }
+			tour.push_back(tsplib ? city - 1 : city);
+		}
+		if (done) break;
+	}
+
+	if (tour.size() == (size_t)n + 1 && tour.front() == tour.back())
+		tour.pop_back();
+	if ((int)tour.size() != n)
+		throw std::runtime_error("Tour has " + std::to_string(tour.size())
+			+ " cities, graph has " + std::to_string(n));
+	std::vector<bool> seen(n, false);
+	int start = -1;
+	for (int k = 0; k < n; ++k) {
+		int c = tour[k];
+		if (c < 0 || c >= n)
+			throw std::runtime_error("Invalid city index in tour: " + std::to_string(c));
+		if (seen[c])
+			throw std::runtime_error("City repeated in tour: " + std::to_string(c));
+		seen[c] = true;
+		if (c == first_node) start = k;
+	}
+
+	std::vector<int> rotated(tour.begin() + start, tour.end());
+	rotated.insert(rotated.end(), tour.begin(), tour.begin() + start);
+	return rotated;
+}
+
+#endif // TSPTOUR_HPP
@@ -0,0 +1,458 @@
+#ifndef WORK_STEALING_RUNNER_HPP
+#define WORK_STEALING_RUNNER_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <stdexcept>
+#include <functional>
+#include "task.hpp"
+#include "idle_parking.hpp"
+#include "topology.hpp"
+
+// Chase-Lev work-stealing deque (Chase & Lev 2005, with the C11 orderings of
+// Le et al. 2013). The owner pushes and pops at the bottom, LIFO; any other
+// thread steals the oldest task at the top. Only the owner may call push(),
+// pop() and clear(). The ring grows when full; replaced rings stay alive
+// until the deque is destroyed, since a thief may still be reading one.
+class ChaseLevDeque : public TaskCollection {
+private:
+    struct Ring {
+        int64_t mask;
+        std::atomic<Task*>* slot;
+        Ring* older;
+        explicit Ring(int64_t capacity, Ring* prev = nullptr)
+            : mask(capacity - 1), slot(new std::atomic<Task*>[capacity]), older(prev) {}
+        ~Ring() { delete[] slot; }
+        int64_t capacity() const { return mask + 1; }
+        Task* get(int64_t i) const { return slot[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, Task* t) { slot[i & mask].store(t, std::memory_order_relaxed); }
+    };
+
+    // thieves hammer top, the owner bottom: keep them on separate lines
+    alignas(64) std::atomic<int64_t> _top;
+    alignas(64) std::atomic<int64_t> _bottom;
+    alignas(64) std::atomic<Ring*> _ring;
+
+    Ring* grow(Ring* r, int64_t b, int64_t t) {
+        Ring* bigger = new Ring(r->capacity() * 2, r);
+        for (int64_t i = t; i < b; ++i) bigger->put(i, r->get(i));
+        _ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+public:
+    // the padding above needs a line-aligned object, and C++11 new only
+    // aligns to max_align_t; the runner allocates its deques on the heap
+    static void* operator new(size_t size) {
+        void* p = nullptr;
+        if (posix_memalign(&p, alignof(ChaseLevDeque), size) != 0) throw std::bad_alloc();
+        return p;
+    }
+    static void operator delete(void* p) { std::free(p); }
+
+    explicit ChaseLevDeque(int64_t capacity = 256) : _top(0), _bottom(0) {
+        int64_t c = 1;
+        while (c < capacity) c <<= 1;
+        _ring.store(new Ring(c), std::memory_order_relaxed);
+    }
+
+    ~ChaseLevDeque() override {
+        clear();
+        Ring* r = _ring.load(std::memory_order_relaxed);
+        while (r) {
+            Ring* older = r->older;
+            delete r;
+            r = older;
+        }
+    }
+
+    int size() const override {
+        int64_t n = _bottom.load(std::memory_order_relaxed) - _top.load(std::memory_order_relaxed);
+        return n > 0 ? (int)n : 0;
+    }
+
+    Task* operator[](int) override {
+        throw std::runtime_error("Index operator not supported for ChaseLevDeque");
+    }
+
+    void push(Task* t) override {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t top = _top.load(std::memory_order_acquire);
+        Ring* r = _ring.load(std::memory_order_relaxed);
+        if (b - top > r->mask) r = grow(r, b, top);
+        r->put(b, t);
+        // release store rather than fence + relaxed: same code on x86, and
+        // visible to race detectors
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // all slots first, then a single release of bottom
+    void pushMany(Task** tasks, int n) override {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t top = _top.load(std::memory_order_acquire);
+        Ring* r = _ring.load(std::memory_order_relaxed);
+        while (b + n - top > r->capacity()) r = grow(r, b, top);
+        for (int i = 0; i < n; ++i) r->put(b + i, tasks[i]);
+        _bottom.store(b + n, std::memory_order_release);
+    }
+
+    // owner only: newest task, or nullptr
+    Task* pop() override {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        if (t > b) {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* task = r->get(b);
+        if (t == b) {
+            // last task: race the thieves for it
+            if (!_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // any thread: oldest task, or nullptr when empty or another thread won
+    Task* steal() {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Ring* r = _ring.load(std::memory_order_acquire);
+        Task* task = r->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+
+    // owner only
+    void clear() override {
+        Task* t;
+        while ((t = pop()) != nullptr) delete t;
+    }
+};
+
+// Runner with one ChaseLevDeque per worker. A worker splits into its own
+// deque and keeps popping from it depth-first; when it runs dry it steals
+// the shallowest tasks of randomly chosen victims. With steal-half a thief
+// takes up to half of the victim's tasks at once and keeps the extra ones
+// in its own deque, so one steal feeds it for longer.
+class WorkStealingTaskRunner : public TaskRunner {
+private:
+    static const int MAX_STEAL_BATCH = 32;
+    static const int SPIN_LOOPS = 64;   // failed sweeps before parking
+
+    std::vector<ChaseLevDeque*> deques;
+    std::vector<std::thread> workers;
+    IdleParking parking;
+    std::atomic<int> tasks_processed;
+    std::atomic<int> tasks_created;
+    std::atomic<int> tasks_pruned;
+    std::atomic<int> outstanding_tasks;
+    std::atomic<int> total_idle_loops;
+    std::atomic<int> total_work_loops;
+    std::atomic<int> total_steals;
+    std::atomic<int> remote_steals;
+    std::atomic<int> tasks_shared;
+    std::atomic<int> finished_workers;
+
+    // see ParallelTaskRunner: thieves that came back empty-handed
+    struct alignas(64) HungryCount {
+        std::atomic<int> value;
+    } hungry_workers;
+
+    // lazy splitting into the worker's own deque, where thieves find it
+    class Sharing : public WorkSharing {
+    private:
+        WorkStealingTaskRunner& runner;
+        ChaseLevDeque* own;
+        CountingCollection deque;
+    public:
+        Sharing(WorkStealingTaskRunner& r, ChaseLevDeque* d)
+            : runner(r), own(d), deque(d, r.outstanding_tasks) {}
+        bool hungry() const override {
+            return runner.hungry_workers.value.load(std::memory_order_relaxed) > 0
+                && own->size() == 0;
+        }
+        void share(Task** tasks, int n) override {
+            if (n <= 0) return;
+            // counted before visible, like split() children
+            deque.pushMany(tasks, n);
+            runner.tasks_created.fetch_add(n, std::memory_order_relaxed);
+            runner.tasks_shared.fetch_add(n, std::memory_order_relaxed);
+            runner.parking.wake(n);
+        }
+    };
+
+    CancellationToken cancel_token;
+    double _time_limit;
+    bool _timed_out;
+
+    int _num_threads;
+    bool _steal_half;
+
+    // with a placement policy: the cpu each worker pins to and its NUMA node;
+    // thieves try victims on their own node before crossing to another
+    Topology::Placement _placement;
+    std::vector<int> worker_cpu;
+    std::vector<int> worker_node;
+    std::function<void(int)> worker_init;
+
+    std::chrono::steady_clock::time_point run_start;
+
+    // see ParallelTaskRunner::watchDeadline(); the budget counts from
+    // run_start, taken before the threads are spawned
+    void watchDeadline() {
+        auto deadline = run_start + std::chrono::duration<double>(_time_limit);
+        while (finished_workers.load(std::memory_order_acquire) < _num_threads) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                _timed_out = true;
+                cancel_token.cancel();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // one sweep over the other deques starting at a random victim, same
+    // node first, then the remote ones
+    Task* stealTask(int thread_id, uint32_t& rng) {
+        if (_num_threads < 2) return nullptr;
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        int first = (int)(rng % (uint32_t)(_num_threads - 1));
+        for (int pass = 0; pass < 2; ++pass)
+        for (int k = 0; k < _num_threads - 1; ++k) {
+            int v = (first + k) % (_num_threads - 1);
+            if (v >= thread_id) ++v;
+            bool remote = worker_node[v] != worker_node[thread_id];
+            if (remote != (pass == 1)) continue;
+            ChaseLevDeque* victim = deques[v];
+            Task* task = victim->steal();
+            if (!task) continue;
+            total_steals.fetch_add(1, std::memory_order_relaxed);
+            if (remote) remote_steals.fetch_add(1, std::memory_order_relaxed);
+            if (_steal_half) {
+                int extra = victim->size() / 2;
+                if (extra > MAX_STEAL_BATCH) extra = MAX_STEAL_BATCH;
+                ChaseLevDeque* own = deques[thread_id];
+                int moved = 0;
+                for (; moved < extra; ++moved) {
+                    Task* more = victim->steal();
+                    if (!more) break;
+                    own->push(more);
+                }
+                // the extras are stealable from here too: one sleeper each
+                parking.wake(moved);
+            }
+            return task;
+        }
+        return nullptr;
+    }
+
+    bool anyWork() const {
+        for (ChaseLevDeque* d : deques)
+            if (d->size() > 0) return true;
+        return false;
+    }
+
+    void worker_function(int thread_id) {
+        if (worker_cpu[thread_id] >= 0) Topology::pinCurrentThread(worker_cpu[thread_id]);
+        if (worker_init) worker_init(worker_node[thread_id]);
+        ChaseLevDeque* own = deques[thread_id];
+        Sharing sharing(*this, own);
+        WorkSharing::current() = &sharing;
+        uint32_t rng = 2463534242u + 2654435761u * (uint32_t)thread_id;
+        int idle_loops = 0;
+        bool hungry = false;
+
+        while (true) {
+            Task* task = own->pop();
+            if (task == nullptr) task = stealTask(thread_id, rng);
+
+            if (task == nullptr) {
+                total_idle_loops.fetch_add(1, std::memory_order_relaxed);
+                if (!hungry) {
+                    hungry = true;
+                    hungry_workers.value.fetch_add(1, std::memory_order_relaxed);
+                }
+                // children are counted before they are published, so a zero
+                // count is final; the deques are checked all the same
+                if (outstanding_tasks.load(std::memory_order_acquire) == 0 && !anyWork()) break;
+                if (++idle_loops < SPIN_LOOPS) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // see ParallelTaskRunner: announce, look again, then sleep;
+                // a steal lost to another thief is not an empty deque
+                idle_loops = 0;
+                uint32_t ticket = parking.prepare();
+                if (anyWork() || outstanding_tasks.load(std::memory_order_acquire) == 0)
+                    parking.cancel();
+                else
+                    parking.park(ticket);
+                continue;
+            }
+            idle_loops = 0;
+            if (hungry) {
+                hungry = false;
+                hungry_workers.value.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            // the children enter outstanding_tasks as they are pushed
+            CountingCollection counted(own, outstanding_tasks);
+            int n = task->split(&counted);
+            total_work_loops.fetch_add(1, std::memory_order_relaxed);
+            if (n > 0) {
+                tasks_created.fetch_add(n, std::memory_order_relaxed);
+                delete task;
+                parking.wake(n - 1);
+            } else if (n < 0) {
+                delete task;
+                tasks_pruned.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                task->solve();
+                delete task;
+                tasks_processed.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (outstanding_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                parking.wakeAll();
+        }
+
+        if (hungry) hungry_workers.value.fetch_sub(1, std::memory_order_relaxed);
+        WorkSharing::current() = nullptr;
+        finished_workers.fetch_add(1, std::memory_order_release);
+    }
+
+public:
+    WorkStealingTaskRunner(int num_threads, bool steal_half = false)
+        : tasks_processed(0),
+          tasks_created(0),
+          tasks_pruned(0),
+          outstanding_tasks(0),
+          total_idle_loops(0),
+          total_work_loops(0),
+          total_steals(0),
+          remote_steals(0),
+          tasks_shared(0),
+          finished_workers(0),
+          _time_limit(0),
+          _timed_out(false),
+          _num_threads(num_threads),
+          _steal_half(steal_half),
+          _placement(Topology::PLACE_NONE) {
+
+        if (_num_threads <= 0) {
+            _num_threads = Topology::defaultThreadCount();
+        }
+
+        for (int i = 0; i < _num_threads; ++i)
+            deques.push_back(new ChaseLevDeque());
+        workers.reserve(_num_threads);
+        worker_cpu.assign(_num_threads, -1);
+        worker_node.assign(_num_threads, 0);
+        hungry_workers.value.store(0, std::memory_order_relaxed);
+    }
+
+    ~WorkStealingTaskRunner() override {
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+        for (ChaseLevDeque* d : deques) delete d;
+    }
+
+    virtual void run(Task* root_task) override {
+        if (!root_task) return;
+        tasks_processed.store(0, std::memory_order_relaxed);
+        tasks_created.store(1, std::memory_order_relaxed);
+        tasks_pruned.store(0, std::memory_order_relaxed);
+        outstanding_tasks.store(1, std::memory_order_relaxed);
+        total_idle_loops.store(0, std::memory_order_relaxed);
+        total_work_loops.store(0, std::memory_order_relaxed);
+        total_steals.store(0, std::memory_order_relaxed);
+        remote_steals.store(0, std::memory_order_relaxed);
+        tasks_shared.store(0, std::memory_order_relaxed);
+        hungry_workers.value.store(0, std::memory_order_relaxed);
+        finished_workers.store(0, std::memory_order_relaxed);
+        cancel_token.reset();
+        _timed_out = false;
+        parking.resetStats();
+
+        // the deques are idle between runs, so this thread may act as owner
+        for (ChaseLevDeque* d : deques) d->clear();
+        deques[0]->push(root_task);
+
+        startTimer();
+        run_start = std::chrono::steady_clock::now();
+
+        std::cout << "Creating " << _num_threads << " work-stealing threads"
+                  << (_steal_half ? " (steal-half)" : "") << "\n";
+
+        for (int i = 0; i < _num_threads; ++i)
+            workers.emplace_back(&WorkStealingTaskRunner::worker_function, this, i);
+
+        if (_time_limit > 0) watchDeadline();
+
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+        workers.clear();
+
+        stopTimer();
+
+        std::cout << "All threads finished. Processed " << tasks_processed.load()
+                  << " tasks, created " << tasks_created.load()
+                  << " tasks, pruned " << tasks_pruned.load() << " tasks.\n";
+        std::cout << "Idle loops: " << total_idle_loops.load()
+                  << ", Work loops: " << total_work_loops.load()
+                  << ", Steals: " << total_steals.load()
+                  << ", Parks: " << parking.parks();
+        if (_placement != Topology::PLACE_NONE)
+            std::cout << ", Remote steals: " << remote_steals.load();
+        if (tasks_shared.load() > 0) std::cout << ", Shared: " << tasks_shared.load();
+        std::cout << "\n";
+    }
+
+    void setTimeLimit(double seconds) { _time_limit = seconds; }
+    bool timedOut() const { return _timed_out; }
+
+    // pin workers and prefer same-node victims; see ParallelTaskRunner
+    void setPlacement(Topology::Placement p) {
+        _placement = p;
+        worker_cpu.assign(_num_threads, -1);
+        worker_node.assign(_num_threads, 0);
+        if (p == Topology::PLACE_NONE) return;
+        std::vector<CpuInfo> cpus = Topology().placement(p, _num_threads);
+        for (int i = 0; i < (int)cpus.size(); ++i) {
+            worker_cpu[i] = cpus[i].cpu;
+            worker_node[i] = cpus[i].node;
+        }
+    }
+
+    // see ParallelTaskRunner::setWorkerInit()
+    void setWorkerInit(const std::function<void(int node)>& init) { worker_init = init; }
+    CancellationToken& cancellation() { return cancel_token; }
+
+    int getTasksProcessed() const { return tasks_processed.load(); }
+    int getTasksCreated() const { return tasks_created.load(); }
+    int getTasksPruned() const { return tasks_pruned.load(); }
+    int getTotalIdleLoops() const { return total_idle_loops.load(); }
+    int getTotalWorkLoops() const { return total_work_loops.load(); }
+    int getSteals() const { return total_steals.load(); }
+    int getRemoteSteals() const { return remote_steals.load(); }
+    int getTasksShared() const { return tasks_shared.load(); }
+};
+
+#endif // WORK_STEALING_RUNNER_HPP